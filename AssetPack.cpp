@@ -0,0 +1,155 @@
+#include "AssetPack.h"
+#include "FileStamp.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+constexpr char MAGIC[4]{'A', 'P', 'A', 'K'};
+constexpr char PADDING[AssetPack::ALIGNMENT]{};
+
+std::uint64_t alignUp(std::uint64_t offset) {
+    return (offset + AssetPack::ALIGNMENT - 1) / AssetPack::ALIGNMENT * AssetPack::ALIGNMENT;
+}
+
+template <typename T> void write(std::ofstream &file, const T *data, std::size_t count = 1) {
+    file.write(reinterpret_cast<const char *>(data), sizeof(T) * count);
+}
+
+} // namespace
+
+std::string AssetPack::entryName(const std::string &path) {
+    std::string name = std::filesystem::path(path).lexically_normal().generic_string();
+    if (name.starts_with("./")) {
+        name.erase(0, 2);
+    }
+    return name;
+}
+
+bool AssetPack::build(const std::string &root, const std::string &packPath) {
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+
+    struct Source {
+        std::string name;
+        std::string path;
+        FileStamp stamp;
+    };
+    std::vector<Source> sources;
+    const std::string packName = entryName(packPath);
+    for (const auto &entry : std::filesystem::recursive_directory_iterator(root)) {
+        const std::string path = entry.path().generic_string();
+        // Half-written caches and the pack itself, should it live under root
+        if (!entry.is_regular_file() || entry.path().extension() == ".tmp" ||
+            entryName(path) == packName) {
+            continue;
+        }
+        Source source{entryName(path), path, {}};
+        if (!FileStamp::read(path, source.stamp)) {
+            std::cerr << "Failed to read asset: " << path << std::endl;
+            return false;
+        }
+        sources.push_back(std::move(source));
+    }
+    std::sort(sources.begin(), sources.end(),
+              [](const Source &a, const Source &b) { return a.name < b.name; });
+
+    std::vector<Entry> entries;
+    std::string paths;
+    for (const auto &source : sources) {
+        entries.push_back({0, source.stamp.size, source.stamp.modified,
+                           static_cast<std::uint32_t>(paths.size()),
+                           static_cast<std::uint32_t>(source.name.size())});
+        paths += source.name;
+    }
+    std::uint64_t offset = sizeof(Header) + entries.size() * sizeof(Entry) + paths.size();
+    for (auto &entry : entries) {
+        entry.offset = alignUp(offset);
+        offset = entry.offset + entry.size;
+    }
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.entryCount = static_cast<std::uint32_t>(entries.size());
+    header.pathBytes = static_cast<std::uint32_t>(paths.size());
+
+    // Write to a temporary file first so a half-written pack is never mounted
+    const std::string temporaryPath = packPath + ".tmp";
+    bool written = false;
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        write(file, &header);
+        write(file, entries.data(), entries.size());
+        write(file, paths.data(), paths.size());
+
+        std::uint64_t position = sizeof(Header) + entries.size() * sizeof(Entry) + paths.size();
+        written = static_cast<bool>(file);
+        for (std::size_t i = 0; i < sources.size() && written; ++i) {
+            MappedFile contents(sources[i].path);
+            if (!contents.isOpen() || contents.size() != entries[i].size) {
+                std::cerr << "Asset changed while packing: " << sources[i].path << std::endl;
+                written = false;
+                break;
+            }
+            write(file, PADDING, entries[i].offset - position);
+            write(file, contents.data(), contents.size());
+            position = entries[i].offset + entries[i].size;
+            written = static_cast<bool>(file);
+        }
+    }
+
+    std::error_code error;
+    if (written) {
+        std::filesystem::rename(temporaryPath, packPath, error);
+    }
+    if (!written || error) {
+        std::filesystem::remove(temporaryPath, error);
+        std::cerr << "Failed to write asset pack: " << packPath << std::endl;
+        return false;
+    }
+
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << "Packed " << entries.size() << " files (" << offset / (1024.0 * 1024.0)
+              << " MiB) into " << packPath << " in " << seconds << " s" << std::endl;
+    return true;
+}
+
+bool AssetPack::validate(const char *data, std::size_t size) {
+    Header header;
+    if (size < sizeof(Header)) {
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(Header));
+    const std::uint64_t indexBytes =
+        static_cast<std::uint64_t>(header.entryCount) * sizeof(Entry) + header.pathBytes;
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        indexBytes > size - sizeof(Header)) {
+        return false;
+    }
+
+    const auto *entries = reinterpret_cast<const Entry *>(data + sizeof(Header));
+    const char *paths = data + sizeof(Header) + header.entryCount * sizeof(Entry);
+    std::string_view previous;
+    for (std::uint32_t i = 0; i < header.entryCount; ++i) {
+        const Entry &entry = entries[i];
+        if (entry.offset > size || entry.size > size - entry.offset ||
+            entry.pathOffset > header.pathBytes ||
+            entry.pathLength > header.pathBytes - entry.pathOffset) {
+            return false;
+        }
+        // Lookups binary search the index
+        const std::string_view path(paths + entry.pathOffset, entry.pathLength);
+        if (i > 0 && path <= previous) {
+            return false;
+        }
+        previous = path;
+    }
+    return true;
+}
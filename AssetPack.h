@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Single file bundle of game assets (.pack). It starts with a Header, followed by one Entry per
+// file sorted by path, then the paths themselves and finally the file contents, each one aligned
+// to ALIGNMENT bytes. The pack is mapped whole and read through VirtualFileSystem.
+namespace AssetPack {
+// Bump whenever the layout changes
+constexpr std::uint32_t VERSION{1};
+// Every file starts on a cache line, so its contents can be read in place
+constexpr std::size_t ALIGNMENT{64};
+
+struct Header {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t entryCount;
+    std::uint32_t pathBytes;
+};
+
+struct Entry {
+    std::uint64_t offset; // From the start of the pack
+    std::uint64_t size;
+    std::int64_t modified; // Of the source file, so caches derived from it stay valid
+    std::uint32_t pathOffset; // Into the paths that follow the entries
+    std::uint32_t pathLength;
+};
+
+// The name a file has inside a pack: "./assets/a/../b.png" becomes "assets/b.png"
+std::string entryName(const std::string &path);
+// Packs every file under root into packPath. Files are named by their path as seen from the
+// working directory (e.g. "assets/levelup.mp3"), which is how the game asks for them.
+bool build(const std::string &root, const std::string &packPath);
+// Checks the header and index of a mapped pack
+bool validate(const char *data, std::size_t size);
+}
@@ -0,0 +1,103 @@
+#include "AssetStreamer.h"
+#include "Trace.h"
+#include "ThreadPool.h"
+#include <chrono>
+
+AssetStreamer::AssetStreamer() {
+    // Create the pool first so that it outlives the streamer at exit
+    ThreadPool::getInstance();
+}
+
+AssetStreamer::~AssetStreamer() {
+    // Nobody will upload any more, so release the workers waiting for room in the queue and let
+    // the remaining load tasks finish before the members go away
+    std::unique_lock lock(mutex);
+    stopping = true;
+    uploadTaken.notify_all();
+    uploadTaken.wait(lock, [this] { return loading == 0; });
+}
+
+void AssetStreamer::enqueue(std::function<void()> load, std::function<void()> upload) {
+    {
+        std::lock_guard lock(mutex);
+        ++pending;
+        ++loading;
+    }
+
+    ThreadPool::getInstance().submit([this, load = std::move(load), upload = std::move(upload)] {
+        bool skip;
+        {
+            std::lock_guard lock(mutex);
+            skip = stopping;
+        }
+        if (!skip) {
+            load();
+        }
+
+        std::unique_lock lock(mutex);
+        uploadTaken.wait(
+            lock, [this] { return stopping || readyUploads.size() < MAX_READY_UPLOADS; });
+        if (!stopping) {
+            readyUploads.push_back(std::move(upload));
+            uploadReady.notify_one();
+        }
+        --loading;
+        uploadTaken.notify_all();
+    });
+}
+
+bool AssetStreamer::pump(double budgetMs) {
+    using Clock = std::chrono::steady_clock;
+    const auto deadline =
+        Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                           std::chrono::duration<double, std::milli>(budgetMs));
+
+    do {
+        std::function<void()> upload;
+        {
+            std::lock_guard lock(mutex);
+            if (readyUploads.empty()) {
+                break;
+            }
+            upload = std::move(readyUploads.front());
+            readyUploads.pop_front();
+        }
+        uploadTaken.notify_one();
+
+        upload();
+
+        std::lock_guard lock(mutex);
+        if (--pending == 0) {
+            return true;
+        }
+    } while (Clock::now() < deadline);
+
+    return false;
+}
+
+void AssetStreamer::flush() {
+    TRACE_SCOPE("Wait for streamed assets");
+    while (true) {
+        std::function<void()> upload;
+        {
+            std::unique_lock lock(mutex);
+            uploadReady.wait(lock, [this] { return pending == 0 || !readyUploads.empty(); });
+            if (pending == 0) {
+                return;
+            }
+            upload = std::move(readyUploads.front());
+            readyUploads.pop_front();
+        }
+        uploadTaken.notify_one();
+
+        upload();
+
+        std::lock_guard lock(mutex);
+        --pending;
+    }
+}
+
+std::size_t AssetStreamer::getPendingCount() const {
+    std::lock_guard lock(mutex);
+    return pending;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+// Loads assets in the background: the load step (parsing, decoding) runs on the thread pool and
+// the upload step (anything touching OpenGL) is queued for the GL thread, which drains the queue a
+// few milliseconds per frame with pump(). Scenes keep rendering while assets arrive.
+class AssetStreamer {
+  public:
+    static AssetStreamer &getInstance() {
+        static AssetStreamer instance;
+        return instance;
+    }
+
+    AssetStreamer(const AssetStreamer &) = delete;
+    AssetStreamer &operator=(const AssetStreamer &) = delete;
+
+    // Runs load on a worker thread and then upload on the GL thread
+    void enqueue(std::function<void()> load, std::function<void()> upload);
+    // Runs queued uploads until budgetMs have passed (always at least one if any is ready).
+    // Returns true when the last outstanding asset was uploaded during this call.
+    bool pump(double budgetMs);
+    // Blocks until every outstanding asset has been uploaded. GL thread only.
+    void flush();
+
+    std::size_t getPendingCount() const;
+
+  private:
+    AssetStreamer();
+    ~AssetStreamer();
+
+    // Loaded assets waiting for upload are kept in memory, so workers wait once this many are
+    // ready instead of staging a whole scene's worth of pixels at once
+    static constexpr std::size_t MAX_READY_UPLOADS{8};
+
+    std::deque<std::function<void()>> readyUploads;
+    std::size_t pending{0}; // Enqueued but not uploaded yet
+    std::size_t loading{0}; // Load tasks that haven't handed over their upload yet
+    bool stopping{false};
+    mutable std::mutex mutex;
+    std::condition_variable uploadTaken; // Also signalled when a load task finishes
+    std::condition_variable uploadReady;
+};
@@ -1,9 +1,94 @@
 #include "AudioEngine.h"
+#include "Trace.h"
+#include "VirtualFileSystem.h"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <memory>
+
+namespace {
+
+// miniaudio file callbacks that read sounds through VirtualFileSystem, so they can come from the
+// asset pack
+struct OpenAsset {
+    AssetFile file;
+    std::size_t cursor{0};
+};
+
+ma_result openAsset(ma_vfs *, const char *path, ma_uint32 openMode, ma_vfs_file *handle) {
+    if (openMode & MA_OPEN_MODE_WRITE) {
+        return MA_ACCESS_DENIED;
+    }
+    auto asset = std::make_unique<OpenAsset>();
+    if (!VirtualFileSystem::getInstance().open(path, asset->file)) {
+        return MA_DOES_NOT_EXIST;
+    }
+    *handle = asset.release();
+    return MA_SUCCESS;
+}
+
+ma_result openAssetW(ma_vfs *, const wchar_t *, ma_uint32, ma_vfs_file *) {
+    return MA_NOT_IMPLEMENTED;
+}
+
+ma_result closeAsset(ma_vfs *, ma_vfs_file handle) {
+    delete static_cast<OpenAsset *>(handle);
+    return MA_SUCCESS;
+}
+
+ma_result readAsset(ma_vfs *, ma_vfs_file handle, void *destination, size_t bytes,
+                    size_t *bytesRead) {
+    auto *asset = static_cast<OpenAsset *>(handle);
+    const std::size_t count = std::min(bytes, asset->file.size() - asset->cursor);
+    std::memcpy(destination, asset->file.data() + asset->cursor, count);
+    asset->cursor += count;
+    if (bytesRead != nullptr) {
+        *bytesRead = count;
+    }
+    return count == 0 && bytes > 0 ? MA_AT_END : MA_SUCCESS;
+}
+
+ma_result writeAsset(ma_vfs *, ma_vfs_file, const void *, size_t, size_t *) {
+    return MA_NOT_IMPLEMENTED;
+}
+
+ma_result seekAsset(ma_vfs *, ma_vfs_file handle, ma_int64 offset, ma_seek_origin origin) {
+    auto *asset = static_cast<OpenAsset *>(handle);
+    ma_int64 base = 0;
+    if (origin == ma_seek_origin_current) {
+        base = static_cast<ma_int64>(asset->cursor);
+    } else if (origin == ma_seek_origin_end) {
+        base = static_cast<ma_int64>(asset->file.size());
+    }
+    const ma_int64 position = base + offset;
+    if (position < 0 || position > static_cast<ma_int64>(asset->file.size())) {
+        return MA_BAD_SEEK;
+    }
+    asset->cursor = static_cast<std::size_t>(position);
+    return MA_SUCCESS;
+}
+
+ma_result tellAsset(ma_vfs *, ma_vfs_file handle, ma_int64 *cursor) {
+    *cursor = static_cast<ma_int64>(static_cast<OpenAsset *>(handle)->cursor);
+    return MA_SUCCESS;
+}
+
+ma_result assetInfo(ma_vfs *, ma_vfs_file handle, ma_file_info *info) {
+    info->sizeInBytes = static_cast<OpenAsset *>(handle)->file.size();
+    return MA_SUCCESS;
+}
+
+ma_vfs_callbacks assetCallbacks{openAsset, openAssetW, closeAsset, readAsset,
+                                writeAsset, seekAsset, tellAsset, assetInfo};
+
+} // namespace
 
 void AudioEngine::initialize() {
+    TRACE_SCOPE("Initialize audio");
     // Initialize the audio engine
-    ma_result result = ma_engine_init(nullptr, &engine);
+    ma_engine_config config = ma_engine_config_init();
+    config.pResourceManagerVFS = &assetCallbacks;
+    ma_result result = ma_engine_init(&config, &engine);
     if (result != MA_SUCCESS) {
         std::cerr << "Failed to initialize audio engine" << std::endl;
     }
@@ -21,6 +106,7 @@ void AudioEngine::playSound(const std::string &soundFile) {
 }
 
 void AudioEngine::playMusic(const std::string &musicFile, bool loop) {
+    TRACE_SCOPE("Open music", musicFile);
     // Uninitialize previous music sound if it's already initialized
     ma_sound_stop(&musicSound);
     ma_sound_uninit(&musicSound);
@@ -1,17 +1,23 @@
 #include "BattleScene.h"
+#include "GLState.h"
+#include "ModelRegistry.h"
 #include "MouseHandler.h"
+#include "RenderQueue.h"
+#include "Trace.h"
 #include "freeglut.h"
 #include "WorldScene.h"
 #include <iostream>
 
 void BattleScene::initialize() {
     if (!isInitialized) {
+        // Streamed in, each model appears once it has been uploaded
+        auto &models = ModelRegistry::getInstance();
         // Battle background
-        battleBackground.loadFromFile(
-            "./assets/art/models/battle-scene/Map_Base_01_First_Steppe.obj");
+        battleBackground =
+            models.loadAsync("./assets/art/models/battle-scene/Map_Base_01_First_Steppe.obj");
         // Pokemon models
-        playerPokemon.loadFromFile("./assets/art/models/staraptor/staraptor.obj");
-        rivalPokemon.loadFromFile("./assets/art/models/kricketot/kricketot.obj");
+        playerPokemon = models.loadAsync("./assets/art/models/staraptor/staraptor.obj");
+        rivalPokemon = models.loadAsync("./assets/art/models/kricketot/kricketot.obj");
         isInitialized = true;
     }
     // TODO
@@ -38,38 +44,40 @@ void BattleScene::registerInputCallbacks() {
 
 void BattleScene::render() {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
+    GLState::matrixMode(GL_MODELVIEW);
+    GLState::loadIdentity();
     // Battle background
-    glPushMatrix();
-    glRotated(beta, 1.0, 0.0, 0.0);
-    glRotated(-alpha, 0.0, 1.0, 0.0);
-    glScaled(scale, scale, scale);
+    GLState::pushMatrix();
+    GLState::rotated(beta, 1.0, 0.0, 0.0);
+    GLState::rotated(-alpha, 0.0, 1.0, 0.0);
+    GLState::scaled(scale, scale, scale);
 
-    battleBackground.render();
-    glPopMatrix();
+    battleBackground->render();
+    GLState::popMatrix();
 
     // Player Pokemon
-    glPushMatrix();
-    glRotated(beta, 1.0, 0.0, 0.0);
-    glRotated(-alpha, 0.0, 1.0, 0.0);
-    glRotated(180, 0.0, 1.0, 0.0);
-    glScaled(scale * 4, scale * 4, scale * 4);
-    glTranslated(0.0, 0.0, -3.0);
-    playerPokemon.render();
-    glPopMatrix();
+    GLState::pushMatrix();
+    GLState::rotated(beta, 1.0, 0.0, 0.0);
+    GLState::rotated(-alpha, 0.0, 1.0, 0.0);
+    GLState::rotated(180, 0.0, 1.0, 0.0);
+    GLState::scaled(scale * 4, scale * 4, scale * 4);
+    GLState::translated(0.0, 0.0, -3.0);
+    playerPokemon->render();
+    GLState::popMatrix();
 
     // Rival Pokemon
-    glPushMatrix();
-    glRotated(beta, 1.0, 0.0, 0.0);
-    glRotated(-alpha, 0.0, 1.0, 0.0);
-    glScaled(scale * 4, scale * 4, scale * 4);
-    glTranslated(0.0, 0.0, -3.0);
-    rivalPokemon.render();
-    glPopMatrix();
-
-    drawUI();
-
+    GLState::pushMatrix();
+    GLState::rotated(beta, 1.0, 0.0, 0.0);
+    GLState::rotated(-alpha, 0.0, 1.0, 0.0);
+    GLState::scaled(scale * 4, scale * 4, scale * 4);
+    GLState::translated(0.0, 0.0, -3.0);
+    rivalPokemon->render();
+    GLState::popMatrix();
+
+    auto &queue = RenderQueue::getInstance();
+    queue.submitCustom(RenderQueue::Pass::Overlay, RenderQueue::Shader::FixedFunction,
+                       [](const void *, std::uintptr_t) { getInstance().drawUI(); }, nullptr);
+    queue.flush();
     glutSwapBuffers();
 }
 
@@ -85,16 +93,16 @@ void BattleScene::drawUI() {
     int windowWidth = glutGet(GLUT_WINDOW_WIDTH);
     int windowHeight = glutGet(GLUT_WINDOW_HEIGHT);
 
-    glDisable(GL_DEPTH_TEST);
+    GLState::disable(GL_DEPTH_TEST);
     // Switch to orthographic projection for 2D overlay
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
-    glLoadIdentity();
+    GLState::matrixMode(GL_PROJECTION);
+    GLState::pushMatrix();
+    GLState::loadIdentity();
     gluOrtho2D(0, windowWidth, 0, windowHeight);
 
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glLoadIdentity();
+    GLState::matrixMode(GL_MODELVIEW);
+    GLState::pushMatrix();
+    GLState::loadIdentity();
 
     // Draw each menu entry
     for (int i = 0; i < battleOptions.size(); i++) {
@@ -126,13 +134,13 @@ void BattleScene::drawUI() {
     drawHPBars(windowWidth, windowHeight, playerPkm, rivalPkm);
 
     // Restore previous projection and modelview matrices
-    glPopMatrix();
-    glMatrixMode(GL_PROJECTION);
-    glPopMatrix();
-    glMatrixMode(GL_MODELVIEW);
+    GLState::popMatrix();
+    GLState::matrixMode(GL_PROJECTION);
+    GLState::popMatrix();
+    GLState::matrixMode(GL_MODELVIEW);
 
     // Re-enable depth testing after 2D overlay
-    glEnable(GL_DEPTH_TEST);
+    GLState::enable(GL_DEPTH_TEST);
 }
 
 // TODO
@@ -231,6 +239,14 @@ void BattleScene::endBattle() {
 
 void BattleScene::keyboardCallback(unsigned char key, int x, int y) {
     switch (key) {
+    case 't':
+    case 'T':
+        Trace::getInstance().save();
+        break;
+    case 's':
+    case 'S':
+        RenderQueue::getInstance().printStats();
+        break;
     case 13: // Enter key
     case 'c':
     case 'C':
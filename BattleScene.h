@@ -5,6 +5,7 @@
 #include "Direction.h"
 #include "Pokemon.h"
 #include <array>
+#include <memory>
 
 class BattleScene : public Scene {
   public:
@@ -31,9 +32,9 @@ class BattleScene : public Scene {
 
   private:
     BattleScene() = default; // Private constructor for singleton
-    Object battleBackground;
-    Object playerPokemon;
-    Object rivalPokemon;
+    std::shared_ptr<Object> battleBackground;
+    std::shared_ptr<Object> playerPokemon;
+    std::shared_ptr<Object> rivalPokemon;
     // TODO
     Pokemon playerPkm{"Staraptor", 60, 25, 10};
     Pokemon rivalPkm{"Kricketot", 50, 20, 8};
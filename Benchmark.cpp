@@ -0,0 +1,513 @@
+#include "Benchmark.h"
+#include "AssetPack.h"
+#include "MeshBuilder.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "ObjParser.h"
+#include "TextureLoader.h"
+#include "ThreadPool.h"
+#include "VertexCodec.h"
+#include "VirtualFileSystem.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int RUNS_PER_FILE{5};
+constexpr std::size_t PAGE_SIZE{4096};
+
+// The original std::istringstream based OBJ loader, kept as the reference implementation
+void parseObjWithStreams(const std::string &filename, Mesh &mesh) {
+    mesh = Mesh{};
+    std::ifstream inputFile(filename);
+    std::string currentGroup;
+    std::string line;
+    while (std::getline(inputFile, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream stream(line);
+        std::string keyword;
+        stream >> keyword;
+
+        if (keyword == "v") {
+            Vertex vertex;
+            stream >> vertex.x >> vertex.y >> vertex.z;
+            mesh.vertices.push_back(vertex);
+        } else if (keyword == "vn") {
+            Normal normal;
+            stream >> normal.nx >> normal.ny >> normal.nz;
+            mesh.normals.push_back(normal);
+        } else if (keyword == "vt") {
+            TextureCoord textureCoord;
+            stream >> textureCoord.u >> textureCoord.v;
+            mesh.textureCoords.push_back(textureCoord);
+        } else if (keyword == "f") {
+            std::vector<VertexIndex> corners;
+            std::string token;
+            while (stream >> token) {
+                std::istringstream tokenStream(token);
+                std::string index;
+                std::vector<int> indices;
+                while (std::getline(tokenStream, index, '/')) {
+                    indices.push_back(std::stoi(index) - 1);
+                }
+                corners.push_back({indices.at(0), indices.at(1), indices.at(2)});
+            }
+            // Same fan triangulation as ObjParser so polygons compare equal
+            auto &groupIndices = mesh.groups[currentGroup].indices;
+            for (std::size_t i = 2; i < corners.size(); ++i) {
+                groupIndices.push_back(corners[0]);
+                groupIndices.push_back(corners[i - 1]);
+                groupIndices.push_back(corners[i]);
+            }
+        } else if (keyword == "g") {
+            stream >> currentGroup;
+        } else if (keyword == "mtllib") {
+            std::string materialLibrary;
+            stream >> materialLibrary;
+            mesh.materialLibraries.push_back(materialLibrary);
+        } else if (keyword == "usemtl") {
+            stream >> mesh.groups[currentGroup].material;
+        }
+    }
+    ObjParser::calculateBoundingBox(mesh);
+}
+
+bool sameVertex(const Vertex &a, const Vertex &b) {
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+bool sameMesh(const Mesh &a, const Mesh &b) {
+    if (a.vertices.size() != b.vertices.size() || a.normals.size() != b.normals.size() ||
+        a.textureCoords.size() != b.textureCoords.size() || a.groups.size() != b.groups.size() ||
+        a.materialLibraries != b.materialLibraries ||
+        !sameVertex(a.boundingBox.min, b.boundingBox.min) ||
+        !sameVertex(a.boundingBox.max, b.boundingBox.max)) {
+        return false;
+    }
+    for (const auto &[name, group] : a.groups) {
+        auto other = b.groups.find(name);
+        if (other == b.groups.end() || other->second.material != group.material ||
+            other->second.indices.size() != group.indices.size()) {
+            return false;
+        }
+        for (std::size_t i = 0; i < group.indices.size(); ++i) {
+            const auto &x = group.indices[i];
+            const auto &y = other->second.indices[i];
+            if (x.vertex != y.vertex || x.texCoord != y.texCoord || x.normal != y.normal) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Every corner of the welded mesh must draw the same attributes as the parsed corner it came from,
+// after the same quantization
+bool sameCorners(const Mesh &mesh, const IndexedMesh &indexed) {
+    if (mesh.groups.size() != indexed.sections.size()) {
+        return false;
+    }
+    for (const auto &section : indexed.sections) {
+        auto group = mesh.groups.find(section.name);
+        if (group == mesh.groups.end() || group->second.material != section.material ||
+            group->second.indices.size() != section.indices.size()) {
+            return false;
+        }
+        for (std::size_t i = 0; i < section.indices.size(); ++i) {
+            const std::uint32_t index = section.indices[i];
+            const auto &corner = group->second.indices[i];
+            PackedVertex expected{};
+            if (corner.texCoord >= 0) {
+                expected.u = static_cast<float>(mesh.textureCoords[corner.texCoord].u);
+                expected.v = static_cast<float>(mesh.textureCoords[corner.texCoord].v);
+            }
+            if (corner.normal >= 0) {
+                expected.nx = static_cast<float>(mesh.normals[corner.normal].nx);
+                expected.ny = static_cast<float>(mesh.normals[corner.normal].ny);
+                expected.nz = static_cast<float>(mesh.normals[corner.normal].nz);
+            }
+            expected.x = static_cast<float>(mesh.vertices[corner.vertex].x);
+            expected.y = static_cast<float>(mesh.vertices[corner.vertex].y);
+            expected.z = static_cast<float>(mesh.vertices[corner.vertex].z);
+            if (VertexCodec::decode(indexed.vertices[section.firstVertex + index]) !=
+                VertexCodec::decode(VertexCodec::encode(expected))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool sameIndexedMesh(const IndexedMesh &a, const IndexedMesh &b) {
+    if (a.vertices != b.vertices || a.sections.size() != b.sections.size() ||
+        a.materialLibraries != b.materialLibraries || a.optimizedOrder != b.optimizedOrder ||
+        !sameVertex(a.boundingBox.min, b.boundingBox.min) ||
+        !sameVertex(a.boundingBox.max, b.boundingBox.max)) {
+        return false;
+    }
+    for (std::size_t i = 0; i < a.sections.size(); ++i) {
+        const auto &x = a.sections[i];
+        const auto &y = b.sections[i];
+        if (x.name != y.name || x.material != y.material || x.firstVertex != y.firstVertex ||
+            x.vertexCount != y.vertexCount || x.indices != y.indices || x.levels != y.levels) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Same triangles in any order, each starting from any of its corners
+bool sameTriangles(const std::vector<std::uint32_t> &a, const std::vector<std::uint32_t> &b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    auto canonical = [](const std::vector<std::uint32_t> &indices) {
+        std::vector<std::array<std::uint32_t, 3>> triangles;
+        for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+            std::array<std::uint32_t, 3> triangle{indices[i], indices[i + 1], indices[i + 2]};
+            std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()),
+                        triangle.end());
+            triangles.push_back(triangle);
+        }
+        std::sort(triangles.begin(), triangles.end());
+        return triangles;
+    };
+    return canonical(a) == canonical(b);
+}
+
+// Best of several runs, in milliseconds
+template <typename Function> double timeBestOf(Function &&function) {
+    double best = std::numeric_limits<double>::max();
+    for (int run = 0; run < RUNS_PER_FILE; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+std::vector<std::filesystem::path> findObjFiles(const std::string &assetsRoot) {
+    std::vector<std::filesystem::path> files;
+    for (const auto &entry : std::filesystem::recursive_directory_iterator(assetsRoot)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".obj") {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+// Bytes taken by the section list and index buffers, which all vertex formats share
+std::size_t sectionBytes(const IndexedMesh &mesh) {
+    std::size_t bytes = 0;
+    for (const auto &section : mesh.sections) {
+        bytes += sizeof(Section) + section.name.size() + section.material.size() +
+                 section.indices.getBytes();
+        for (const auto &level : section.levels) {
+            bytes += level.getBytes();
+        }
+    }
+    return bytes;
+}
+
+} // namespace
+
+void Benchmark::runObjLoad(const std::string &assetsRoot) {
+    const auto files = findObjFiles(assetsRoot);
+
+    std::printf("Worker threads: %zu\n", ThreadPool::getInstance().getThreadCount());
+    std::printf("%-72s %8s %11s %11s %11s %9s %9s %11s %7s %6s  %s\n", "OBJ file", "KiB",
+                "streams ms", "serial ms", "parallel ms", "weld ms", "LOD ms", "meshbin ms",
+                "welded", "same", "triangles per level");
+
+    double totalStreams = 0.0, totalSerial = 0.0, totalParallel = 0.0, totalWeld = 0.0,
+           totalLevels = 0.0, totalCached = 0.0;
+    for (const auto &file : files) {
+        const std::string filename = file.generic_string();
+        Mesh reference, serial, parallel;
+        IndexedMesh indexed, cached;
+
+        double streams = timeBestOf([&] { parseObjWithStreams(filename, reference); });
+        double serialTime = timeBestOf(
+            [&] { ObjParser::parseFile(filename, serial, ObjParser::Mode::Serial); });
+        double parallelTime = timeBestOf(
+            [&] { ObjParser::parseFile(filename, parallel, ObjParser::Mode::Parallel); });
+        double weldTime = timeBestOf([&] { MeshBuilder::buildIndexed(serial, indexed); });
+        double levelTime = timeBestOf([&] { MeshBuilder::buildLevels(indexed); });
+        MeshCache::save(filename, indexed);
+        double cachedTime = timeBestOf([&] { MeshCache::load(filename, cached); });
+        totalStreams += streams;
+        totalSerial += serialTime;
+        totalParallel += parallelTime;
+        totalWeld += weldTime;
+        totalLevels += levelTime;
+        totalCached += cachedTime;
+
+        std::size_t corners = 0;
+        for (const auto &[name, group] : serial.groups) {
+            corners += group.indices.size();
+        }
+        // Corners per welded vertex
+        const double ratio =
+            indexed.vertices.empty() ? 0.0 : static_cast<double>(corners) / indexed.vertices.size();
+
+        // Sections that ran out of levels keep drawing their coarsest one
+        std::string levels;
+        for (std::size_t level = 0;; ++level) {
+            std::size_t triangles = 0;
+            bool more = false;
+            for (const auto &section : indexed.sections) {
+                const auto &indices =
+                    level == 0 || section.levels.empty()
+                        ? section.indices
+                        : section.levels[std::min(level, section.levels.size()) - 1];
+                triangles += indices.size() / 3;
+                more = more || level < section.levels.size();
+            }
+            levels += (level == 0 ? "" : " ") + std::to_string(triangles);
+            if (!more) {
+                break;
+            }
+        }
+
+        bool same = sameMesh(reference, serial) && sameMesh(reference, parallel) &&
+                    sameCorners(serial, indexed) && sameIndexedMesh(indexed, cached);
+        std::printf("%-72s %8.1f %11.3f %11.3f %11.3f %9.3f %9.3f %11.3f %6.2fx %6s  %s\n",
+                    filename.c_str(), std::filesystem::file_size(file) / 1024.0, streams,
+                    serialTime, parallelTime, weldTime, levelTime, cachedTime, ratio,
+                    same ? "yes" : "NO", levels.c_str());
+    }
+
+    std::printf("%-72s %8s %11.3f %11.3f %11.3f %9.3f %9.3f %11.3f\n", "Total", "", totalStreams,
+                totalSerial, totalParallel, totalWeld, totalLevels, totalCached);
+}
+
+void Benchmark::runMeshMemory(const std::string &assetsRoot) {
+    std::printf("%-72s %9s %9s %11s %10s %12s %7s\n", "OBJ file", "corners", "vertices",
+                "parsed KiB", "float KiB", "compact KiB", "saved");
+
+    std::size_t totalParsed = 0, totalFloat = 0, totalCompact = 0;
+    for (const auto &file : findObjFiles(assetsRoot)) {
+        const std::string filename = file.generic_string();
+        Mesh mesh;
+        IndexedMesh indexed;
+        if (!ObjParser::parseFile(filename, mesh)) {
+            continue;
+        }
+        MeshBuilder::buildIndexed(mesh, indexed);
+
+        // As parsed: double attributes and one index triple per corner
+        std::size_t corners = 0;
+        std::size_t parsed = mesh.vertices.size() * sizeof(Vertex) +
+                             mesh.textureCoords.size() * sizeof(TextureCoord) +
+                             mesh.normals.size() * sizeof(Normal);
+        for (const auto &[name, group] : mesh.groups) {
+            corners += group.indices.size();
+            parsed += sizeof(Group) + name.size() + group.material.size() +
+                      group.indices.size() * sizeof(VertexIndex);
+        }
+        // Welded, with float or compact vertices
+        const std::size_t sections = sectionBytes(indexed);
+        const std::size_t floats = indexed.vertices.size() * sizeof(PackedVertex) + sections;
+        const std::size_t compact = indexed.vertices.size() * sizeof(CompactVertex) + sections;
+        totalParsed += parsed;
+        totalFloat += floats;
+        totalCompact += compact;
+
+        std::printf("%-72s %9zu %9zu %11.1f %10.1f %12.1f %6.1f%%\n", filename.c_str(), corners,
+                    indexed.vertices.size(), parsed / 1024.0, floats / 1024.0, compact / 1024.0,
+                    100.0 - 100.0 * compact / parsed);
+    }
+
+    std::printf("%-72s %9s %9s %11.1f %10.1f %12.1f %6.1f%%\n", "Total", "", "",
+                totalParsed / 1024.0, totalFloat / 1024.0, totalCompact / 1024.0,
+                100.0 - 100.0 * totalCompact / totalParsed);
+}
+
+void Benchmark::runMeshOrder(const std::string &assetsRoot) {
+    std::printf("%-72s %9s %13s %13s %13s %9s %5s\n", "OBJ file", "triangles", "ACMR/ATVR raw",
+                "vertex cache", "+ overdraw", "time ms", "same");
+
+    MeshOptimizer::CacheStats totalRaw, totalCache, totalOverdraw;
+    double totalTime = 0.0;
+    for (const auto &file : findObjFiles(assetsRoot)) {
+        const std::string filename = file.generic_string();
+        Mesh mesh;
+        IndexedMesh indexed;
+        if (!ObjParser::parseFile(filename, mesh)) {
+            continue;
+        }
+        MeshBuilder::buildIndexed(mesh, indexed);
+
+        MeshOptimizer::CacheStats raw, cache, overdraw;
+        double time = 0.0;
+        // Reordering must keep exactly the same triangles, each with its winding
+        bool same = true;
+        std::vector<PackedVertex> vertices;
+        std::vector<std::uint32_t> indices, optimized;
+        for (const auto &section : indexed.sections) {
+            vertices.resize(section.vertexCount);
+            for (std::uint32_t i = 0; i < section.vertexCount; ++i) {
+                vertices[i] = VertexCodec::decode(indexed.vertices[section.firstVertex + i]);
+            }
+            indices.resize(section.indices.size());
+            for (std::size_t i = 0; i < indices.size(); ++i) {
+                indices[i] = section.indices[i];
+            }
+            raw += MeshOptimizer::analyzeCache(indices, section.vertexCount);
+
+            time += timeBestOf([&] {
+                optimized = indices;
+                MeshOptimizer::optimizeVertexCache(optimized, section.vertexCount);
+            });
+            cache += MeshOptimizer::analyzeCache(optimized, section.vertexCount);
+            time += timeBestOf([&] {
+                std::vector<std::uint32_t> reordered = optimized;
+                MeshOptimizer::optimizeOverdraw(reordered, vertices);
+            });
+            MeshOptimizer::optimizeOverdraw(optimized, vertices);
+            overdraw += MeshOptimizer::analyzeCache(optimized, section.vertexCount);
+
+            same = same && sameTriangles(indices, optimized);
+        }
+        totalRaw += raw;
+        totalCache += cache;
+        totalOverdraw += overdraw;
+        totalTime += time;
+
+        std::printf("%-72s %9zu %6.3f/%-6.3f %6.3f/%-6.3f %6.3f/%-6.3f %9.3f %5s\n",
+                    filename.c_str(), raw.triangles, raw.getAcmr(), raw.getAtvr(),
+                    cache.getAcmr(), cache.getAtvr(), overdraw.getAcmr(), overdraw.getAtvr(),
+                    time, same ? "yes" : "NO");
+    }
+
+    std::printf("%-72s %9zu %6.3f/%-6.3f %6.3f/%-6.3f %6.3f/%-6.3f %9.3f\n", "Total",
+                totalRaw.triangles, totalRaw.getAcmr(), totalRaw.getAtvr(), totalCache.getAcmr(),
+                totalCache.getAtvr(), totalOverdraw.getAcmr(), totalOverdraw.getAtvr(),
+                totalTime);
+}
+
+void Benchmark::runAssetPack(const std::string &assetsRoot) {
+    const std::string packPath =
+        (std::filesystem::path(assetsRoot).parent_path() / "benchmark-assets.pack").string();
+    if (!AssetPack::build(assetsRoot, packPath)) {
+        return;
+    }
+
+    std::vector<std::string> files;
+    std::uintmax_t totalBytes = 0;
+    for (const auto &entry : std::filesystem::recursive_directory_iterator(assetsRoot)) {
+        if (entry.is_regular_file() && entry.path().extension() != ".tmp") {
+            files.push_back(entry.path().generic_string());
+            totalBytes += entry.file_size();
+        }
+    }
+
+    auto &fileSystem = VirtualFileSystem::getInstance();
+    // Opens every file and touches each of its pages, returning the sum of the bytes read
+    auto readAll = [&] {
+        std::uint64_t sum = 0;
+        AssetFile file;
+        for (const auto &path : files) {
+            if (fileSystem.open(path, file)) {
+                for (std::size_t i = 0; i < file.size(); i += PAGE_SIZE) {
+                    sum += static_cast<unsigned char>(file.data()[i]);
+                }
+            }
+        }
+        return sum;
+    };
+    // The first run is as close to a cold start as a running process gets; how close depends on
+    // what the OS still has cached
+    auto measure = [&](bool packed, double &first, double &best, std::uint64_t &sum) {
+        best = std::numeric_limits<double>::max();
+        for (int run = 0; run < RUNS_PER_FILE; ++run) {
+            auto start = std::chrono::steady_clock::now();
+            if (packed) {
+                fileSystem.mount(packPath);
+                fileSystem.setLooseFiles(false);
+            }
+            sum = readAll();
+            std::chrono::duration<double, std::milli> elapsed =
+                std::chrono::steady_clock::now() - start;
+            fileSystem.unmount();
+            fileSystem.setLooseFiles(true);
+            if (run == 0) {
+                first = elapsed.count();
+            }
+            best = std::min(best, elapsed.count());
+        }
+    };
+
+    fileSystem.unmount();
+    double looseFirst, looseBest, packFirst, packBest;
+    std::uint64_t looseSum, packSum;
+    measure(false, looseFirst, looseBest, looseSum);
+    measure(true, packFirst, packBest, packSum);
+
+    std::printf("%-12s %6s %9s %7s %10s %9s %5s\n", "Source", "files", "MiB", "opens", "first ms",
+                "best ms", "same");
+    std::printf("%-12s %6zu %9.2f %7zu %10.3f %9.3f\n", "loose", files.size(),
+                totalBytes / (1024.0 * 1024.0), files.size(), looseFirst, looseBest);
+    std::printf("%-12s %6zu %9.2f %7d %10.3f %9.3f %5s\n", "pack", files.size(),
+                std::filesystem::file_size(packPath) / (1024.0 * 1024.0), 1, packFirst,
+                packBest, looseSum == packSum ? "yes" : "NO");
+
+    std::error_code error;
+    std::filesystem::remove(packPath, error);
+}
+
+void Benchmark::runImageDecode(const std::string &assetsRoot) {
+    std::vector<std::string> files;
+    for (const auto &entry : std::filesystem::recursive_directory_iterator(assetsRoot)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".png") {
+            files.push_back(entry.path().generic_string());
+        }
+    }
+
+    std::vector<TextureLoader::Image> serial, batch;
+    double serialBest = std::numeric_limits<double>::max();
+    double batchBest = std::numeric_limits<double>::max();
+    for (int run = 0; run < RUNS_PER_FILE; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        serial.assign(files.size(), TextureLoader::Image{});
+        for (std::size_t i = 0; i < files.size(); ++i) {
+            TextureLoader::decodeImage(files[i], true, serial[i]);
+        }
+        std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+        serialBest = std::min(serialBest, elapsed.count());
+
+        start = std::chrono::steady_clock::now();
+        TextureLoader::decodeImages(files, true, batch);
+        elapsed = std::chrono::steady_clock::now() - start;
+        batchBest = std::min(batchBest, elapsed.count());
+    }
+
+    std::size_t pixelBytes = 0;
+    bool same = true;
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        pixelBytes += serial[i].pixels.size();
+        same = same && serial[i].width == batch[i].width && serial[i].height == batch[i].height &&
+               serial[i].pixels == batch[i].pixels;
+    }
+
+    std::printf("%zu images, %.2f MiB of pixels, %zu threads\n", files.size(),
+                pixelBytes / (1024.0 * 1024.0), ThreadPool::getInstance().getThreadCount());
+    std::printf("%-12s %9s %8s %5s\n", "Decode", "best ms", "speedup", "same");
+    std::printf("%-12s %9.3f %8.2f\n", "serial", serialBest, 1.0);
+    std::printf("%-12s %9.3f %8.2f %5s\n", "batch", batchBest, serialBest / batchBest,
+                same ? "yes" : "NO");
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+
+// Offline measurements started from the command line (see main)
+namespace Benchmark {
+// Times OBJ loading for every model under assetsRoot: the old stream based parser, the
+// memory-mapped parser in serial and parallel mode, vertex welding, level of detail generation and
+// the .meshbin cache. Also checks that all of them produce the same mesh.
+void runObjLoad(const std::string &assetsRoot);
+// Compares the memory every model under assetsRoot takes as parsed (doubles, one index triple per
+// corner), welded with float vertices and welded with compact vertices
+void runMeshMemory(const std::string &assetsRoot);
+// Measures the vertex cache efficiency (ACMR and ATVR) of every model under assetsRoot in file
+// order, after vertex cache optimization and after overdraw ordering
+void runMeshOrder(const std::string &assetsRoot);
+// Packs everything under assetsRoot into a temporary asset pack and compares opening and reading
+// every file loose against reading it from the mounted pack
+void runAssetPack(const std::string &assetsRoot);
+// Decodes every PNG under assetsRoot one after the other on this thread and then as one batch on
+// the thread pool, and checks that both give the same pixels
+void runImageDecode(const std::string &assetsRoot);
+}
@@ -0,0 +1,52 @@
+#include "BufferObjects.h"
+#include <cstdint>
+
+namespace {
+
+using GenBuffers = void(APIENTRY *)(GLsizei count, GLuint *buffers);
+using DeleteBuffers = void(APIENTRY *)(GLsizei count, const GLuint *buffers);
+using BindBuffer = void(APIENTRY *)(GLenum target, GLuint buffer);
+using BufferData = void(APIENTRY *)(GLenum target, std::intptr_t size, const void *data,
+                                    GLenum usage);
+
+GenBuffers genBuffers{nullptr};
+DeleteBuffers deleteBuffers{nullptr};
+BindBuffer bindBuffer{nullptr};
+BufferData bufferData{nullptr};
+
+template <typename Function> Function lookUp(const char *name) {
+    return reinterpret_cast<Function>(glutGetProcAddress(name));
+}
+
+} // namespace
+
+bool BufferObjects::load() {
+    genBuffers = lookUp<GenBuffers>("glGenBuffers");
+    deleteBuffers = lookUp<DeleteBuffers>("glDeleteBuffers");
+    bindBuffer = lookUp<BindBuffer>("glBindBuffer");
+    bufferData = lookUp<BufferData>("glBufferData");
+    return isAvailable();
+}
+
+bool BufferObjects::isAvailable() {
+    return genBuffers != nullptr && deleteBuffers != nullptr && bindBuffer != nullptr &&
+           bufferData != nullptr;
+}
+
+GLuint BufferObjects::create() {
+    GLuint buffer = 0;
+    genBuffers(1, &buffer);
+    return buffer;
+}
+
+void BufferObjects::destroy(GLuint buffer) {
+    deleteBuffers(1, &buffer);
+}
+
+void BufferObjects::bind(GLenum target, GLuint buffer) {
+    bindBuffer(target, buffer);
+}
+
+void BufferObjects::upload(GLenum target, std::size_t bytes, const void *data) {
+    bufferData(target, static_cast<std::intptr_t>(bytes), data, STATIC_DRAW);
+}
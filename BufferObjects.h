@@ -0,0 +1,23 @@
+#pragma once
+
+#include "freeglut.h"
+#include <cstddef>
+
+// OpenGL 1.5 vertex and index buffers. Windows only exports OpenGL 1.1, so the entry points are
+// looked up at run time through glutGetProcAddress.
+namespace BufferObjects {
+constexpr GLenum ARRAY_BUFFER{0x8892};
+constexpr GLenum ELEMENT_ARRAY_BUFFER{0x8893};
+constexpr GLenum STATIC_DRAW{0x88E4};
+
+// Looks up the entry points. Needs a current context, so call it once the window exists. Returns
+// false if the driver doesn't have them.
+bool load();
+bool isAvailable();
+
+GLuint create();
+void destroy(GLuint buffer);
+void bind(GLenum target, GLuint buffer);
+// Fills the buffer bound to target, replacing what it held
+void upload(GLenum target, std::size_t bytes, const void *data);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+// Size and modification time of a source file, used to tell whether a derived cache is stale
+struct FileStamp {
+    std::uint64_t size{0};
+    std::int64_t modified{0};
+
+    bool operator==(const FileStamp &) const = default;
+
+    static bool read(const std::string &path, FileStamp &stamp) {
+        std::error_code error;
+        auto size = std::filesystem::file_size(path, error);
+        if (error) {
+            return false;
+        }
+        auto modified = std::filesystem::last_write_time(path, error);
+        if (error) {
+            return false;
+        }
+        stamp.size = size;
+        stamp.modified = modified.time_since_epoch().count();
+        return true;
+    }
+};
@@ -0,0 +1,142 @@
+#include "FileWatcher.h"
+#include "Trace.h"
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <system_error>
+
+FileWatcher::~FileWatcher() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+std::string FileWatcher::canonicalPath(const std::string &path) {
+    std::error_code error;
+    auto canonical = std::filesystem::weakly_canonical(path, error);
+    return error ? path : canonical.generic_string();
+}
+
+void FileWatcher::enable() {
+    std::lock_guard lock(mutex);
+    if (thread.joinable()) {
+        return;
+    }
+    enabled = true;
+    thread = std::thread([this] {
+        Trace::getInstance().setThreadName("File watcher");
+        watchLoop();
+    });
+}
+
+FileWatcher::WatchId FileWatcher::watch(const std::string &path, std::function<void()> onChange) {
+    if (!isEnabled()) {
+        return 0;
+    }
+    std::string key = canonicalPath(path);
+    FileStamp stamp;
+    // A file that doesn't exist yet counts as changed once it appears
+    FileStamp::read(key, stamp);
+
+    std::lock_guard lock(mutex);
+    auto [file, inserted] = files.try_emplace(key);
+    if (inserted) {
+        file->second.stamp = stamp;
+    }
+    ++file->second.watchCount;
+    const WatchId id = nextId++;
+    watches.emplace(id, Watch{std::move(key), std::move(onChange)});
+    return id;
+}
+
+void FileWatcher::unwatch(WatchId id) {
+    if (id == 0) {
+        return;
+    }
+    std::lock_guard lock(mutex);
+    auto watch = watches.find(id);
+    if (watch == watches.end()) {
+        return;
+    }
+    if (auto file = files.find(watch->second.path); --file->second.watchCount == 0) {
+        files.erase(file);
+    }
+    watches.erase(watch);
+}
+
+void FileWatcher::poll() {
+    if (!isEnabled()) {
+        return;
+    }
+
+    // Callbacks are copied out so they can watch and unwatch files themselves
+    std::vector<std::function<void()>> callbacks;
+    {
+        std::lock_guard lock(mutex);
+        if (changed.empty()) {
+            return;
+        }
+        for (const auto &path : changed) {
+            std::cout << "Reloading after change: " << path << std::endl;
+        }
+        for (const auto &[id, watch] : watches) {
+            if (std::ranges::find(changed, watch.path) != changed.end()) {
+                callbacks.push_back(watch.onChange);
+            }
+        }
+        changed.clear();
+    }
+
+    for (const auto &onChange : callbacks) {
+        onChange();
+    }
+}
+
+void FileWatcher::watchLoop() {
+    std::vector<std::string> paths;
+    std::vector<FileStamp> stamps;
+    std::unique_lock lock(mutex);
+    while (!stopping) {
+        condition.wait_for(lock, POLL_INTERVAL, [this] { return stopping; });
+        if (stopping) {
+            break;
+        }
+
+        // Touch the disk without holding the lock, so watch and poll never wait for it
+        paths.clear();
+        for (const auto &[path, file] : files) {
+            paths.push_back(path);
+        }
+        lock.unlock();
+        stamps.assign(paths.size(), FileStamp{});
+        for (std::size_t i = 0; i < paths.size(); ++i) {
+            FileStamp::read(paths[i], stamps[i]);
+        }
+        lock.lock();
+
+        for (std::size_t i = 0; i < paths.size(); ++i) {
+            auto file = files.find(paths[i]);
+            if (file == files.end()) {
+                continue; // Unwatched meanwhile
+            }
+            auto &state = file->second;
+            if (stamps[i] == state.stamp) {
+                state.changing = false;
+            } else if (state.changing && stamps[i] == state.pending) {
+                // Editors often save in several writes, so a change is only reported once the
+                // file has stayed the same for a whole interval
+                state.stamp = stamps[i];
+                state.changing = false;
+                changed.push_back(paths[i]);
+            } else {
+                state.pending = stamps[i];
+                state.changing = true;
+            }
+        }
+    }
+}
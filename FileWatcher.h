@@ -0,0 +1,73 @@
+#pragma once
+
+#include "FileStamp.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Notices when asset files change on disk so they can be reloaded while the game runs. A
+// background thread compares the size and modification time of every watched file a few times a
+// second, and poll() runs the callbacks of the changed files on the GL thread, between frames.
+// Off unless enabled, in which case watch does nothing.
+class FileWatcher {
+  public:
+    using WatchId = std::uint64_t;
+
+    static FileWatcher &getInstance() {
+        static FileWatcher instance;
+        return instance;
+    }
+
+    FileWatcher(const FileWatcher &) = delete;
+    FileWatcher &operator=(const FileWatcher &) = delete;
+
+    void enable();
+    bool isEnabled() const {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    // Calls onChange from poll() every time the file at path changes. Returns 0, which unwatch
+    // ignores, when watching is off.
+    WatchId watch(const std::string &path, std::function<void()> onChange);
+    void unwatch(WatchId id);
+    // Runs the callbacks of the files that changed since the last call. GL thread only.
+    void poll();
+
+  private:
+    FileWatcher() = default;
+    ~FileWatcher();
+
+    // How often the watched files are checked
+    static constexpr std::chrono::milliseconds POLL_INTERVAL{250};
+
+    static std::string canonicalPath(const std::string &path);
+    void watchLoop();
+
+    struct Watch {
+        std::string path; // Key in files
+        std::function<void()> onChange;
+    };
+    struct File {
+        FileStamp stamp;   // As last reported
+        FileStamp pending; // Differs from stamp, waiting to settle
+        bool changing{false};
+        std::size_t watchCount{0};
+    };
+    std::unordered_map<WatchId, Watch> watches;
+    std::unordered_map<std::string, File> files; // Keyed by canonical path
+    std::vector<std::string> changed;            // Waiting for poll
+    WatchId nextId{1};
+
+    std::atomic<bool> enabled{false};
+    bool stopping{false};
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::thread thread;
+};
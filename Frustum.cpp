@@ -0,0 +1,44 @@
+#include "Frustum.h"
+#include "GLState.h"
+
+Frustum Frustum::fromCurrentMatrices() {
+    const auto &projection = GLState::getView().projection;
+    const auto &modelView = GLState::getModelView();
+    Matrix clip;
+    for (int column = 0; column < 4; ++column) {
+        for (int row = 0; row < 4; ++row) {
+            double sum = 0.0;
+            for (int k = 0; k < 4; ++k) {
+                sum += projection[k * 4 + row] * modelView[column * 4 + k];
+            }
+            clip[column * 4 + row] = sum;
+        }
+    }
+    return Frustum(clip);
+}
+
+Frustum::Frustum(const Matrix &clip) {
+    // A point is in view when -w <= x, y, z <= w in clip space, so each plane is the last row of
+    // the matrix plus or minus one of the others (Gribb and Hartmann)
+    const auto element = [&](int row, int column) { return clip[column * 4 + row]; };
+    for (int plane = 0; plane < 6; ++plane) {
+        const int axis = plane / 2;
+        const double sign = plane % 2 == 0 ? 1.0 : -1.0;
+        for (int column = 0; column < 4; ++column) {
+            planes[plane][column] = element(3, column) + sign * element(axis, column);
+        }
+    }
+}
+
+bool Frustum::intersects(const BoundingBox &box) const {
+    for (const auto &plane : planes) {
+        // The corner furthest along the plane's normal
+        const double x = plane[0] >= 0.0 ? box.max.x : box.min.x;
+        const double y = plane[1] >= 0.0 ? box.max.y : box.min.y;
+        const double z = plane[2] >= 0.0 ? box.max.z : box.min.z;
+        if (plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < 0.0) {
+            return false;
+        }
+    }
+    return true;
+}
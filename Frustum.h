@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Mesh.h"
+#include <array>
+
+// The volume the camera sees, bounded by six planes, to skip whatever lies outside of it
+class Frustum {
+  public:
+    // Column major, as OpenGL stores matrices
+    using Matrix = std::array<double, 16>;
+
+    // The view volume of the current projection and modelview matrices
+    static Frustum fromCurrentMatrices();
+    // clip is projection * modelview
+    explicit Frustum(const Matrix &clip);
+
+    // False only if box lies entirely outside. Boxes just off a corner may still pass.
+    bool intersects(const BoundingBox &box) const;
+
+  private:
+    // a, b, c, d of each plane, with a x + b y + c z + d >= 0 on the inside
+    std::array<std::array<double, 4>, 6> planes;
+};
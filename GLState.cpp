@@ -0,0 +1,307 @@
+#include "GLState.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numbers>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Everything starts out unknown, so the first call always goes through
+struct Capability {
+    GLenum name;
+    std::optional<bool> enabled;
+};
+// The ones the renderer switches
+std::array<Capability, 4> capabilities{{
+    {GL_TEXTURE_2D, {}},
+    {GL_COLOR_MATERIAL, {}},
+    {GL_DEPTH_TEST, {}},
+    {GL_BLEND, {}},
+}};
+
+struct MaterialValue {
+    GLenum name;
+    std::optional<std::array<GLfloat, 4>> values; // Only the first for GL_SHININESS
+};
+// Of the front faces
+std::array<MaterialValue, 4> materials{{
+    {GL_AMBIENT, {}},
+    {GL_DIFFUSE, {}},
+    {GL_SPECULAR, {}},
+    {GL_SHININESS, {}},
+}};
+
+std::optional<GLuint> boundTexture; // To GL_TEXTURE_2D
+std::optional<std::pair<GLenum, GLenum>> colorMaterialMode;
+std::optional<GLenum> currentMatrixMode;
+bool textureIdentity{false};
+using Matrix = std::array<GLfloat, 16>;
+constexpr Matrix IDENTITY{1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+std::vector<Matrix> modelViews{IDENTITY}; // The stack, the current matrix last
+std::optional<GLState::View> view;        // Of this frame
+GLState::Stats stats{};
+
+// Counts a call, returning true if it is to be skipped
+bool skip(bool unchanged) {
+    ++(unchanged ? stats.elided : stats.issued);
+    return unchanged;
+}
+
+void forgetMaterials() {
+    for (auto &material : materials) {
+        material.values.reset();
+    }
+}
+
+// With GL_COLOR_MATERIAL on, the current color overwrites the material it tracks whenever it is
+// set, so what was uploaded for it doesn't stay known
+bool followsColor(GLenum name) {
+    const auto colorMaterial = std::ranges::find(capabilities, GLenum{GL_COLOR_MATERIAL},
+                                                 &Capability::name);
+    if (colorMaterial->enabled == false) {
+        return false;
+    }
+    if (!colorMaterialMode) {
+        return true;
+    }
+    const GLenum mode = colorMaterialMode->second;
+    return mode == name ||
+           (mode == GL_AMBIENT_AND_DIFFUSE && (name == GL_AMBIENT || name == GL_DIFFUSE));
+}
+
+void setCapability(GLenum name, bool enabled) {
+    const auto capability = std::ranges::find(capabilities, name, &Capability::name);
+    const bool tracked = capability != capabilities.end();
+    if (skip(tracked && capability->enabled == enabled)) {
+        return;
+    }
+    enabled ? glEnable(name) : glDisable(name);
+    if (tracked) {
+        capability->enabled = enabled;
+    }
+    if (name == GL_COLOR_MATERIAL && enabled) {
+        // The current color is applied right away
+        forgetMaterials();
+    }
+}
+
+// Returns whether the material has to be uploaded, remembering it as uploaded if so
+bool changeMaterial(GLenum face, GLenum name, const GLfloat *values) {
+    const auto material = std::ranges::find(materials, name, &MaterialValue::name);
+    if (material == materials.end() || face != GL_FRONT) {
+        // Could be any of them, e.g. GL_AMBIENT_AND_DIFFUSE or GL_FRONT_AND_BACK
+        forgetMaterials();
+        ++stats.issued;
+        return true;
+    }
+    if (followsColor(name)) {
+        material->values.reset();
+        ++stats.issued;
+        return true;
+    }
+
+    std::array<GLfloat, 4> uploaded{};
+    std::copy_n(values, name == GL_SHININESS ? 1 : 4, uploaded.begin());
+    if (skip(material->values == uploaded)) {
+        return false;
+    }
+    material->values = uploaded;
+    return true;
+}
+
+// GL starts out in GL_MODELVIEW, and every switch after that goes through matrixMode
+bool inModelView() {
+    return currentMatrixMode.value_or(GL_MODELVIEW) == GL_MODELVIEW;
+}
+
+// Multiplies the current modelview matrix by matrix on the right, like glMultMatrix
+void multiplyModelView(const std::array<GLdouble, 16> &matrix) {
+    Matrix &current = modelViews.back();
+    const Matrix left = current;
+    for (int column = 0; column < 4; ++column) {
+        for (int row = 0; row < 4; ++row) {
+            double sum = 0.0;
+            for (int k = 0; k < 4; ++k) {
+                sum += left[k * 4 + row] * matrix[column * 4 + k];
+            }
+            current[column * 4 + row] = static_cast<GLfloat>(sum);
+        }
+    }
+}
+
+} // namespace
+
+void GLState::enable(GLenum capability) {
+    setCapability(capability, true);
+}
+
+void GLState::disable(GLenum capability) {
+    setCapability(capability, false);
+}
+
+void GLState::bindTexture(GLenum target, GLuint texture) {
+    const bool tracked = target == GL_TEXTURE_2D;
+    if (skip(tracked && boundTexture == texture)) {
+        return;
+    }
+    glBindTexture(target, texture);
+    if (tracked) {
+        boundTexture = texture;
+    }
+}
+
+void GLState::deleteTextures(GLsizei count, const GLuint *textures) {
+    ++stats.issued;
+    glDeleteTextures(count, textures);
+    if (boundTexture && std::find(textures, textures + count, *boundTexture) != textures + count) {
+        boundTexture = 0;
+    }
+}
+
+void GLState::colorMaterial(GLenum face, GLenum mode) {
+    if (skip(colorMaterialMode == std::pair{face, mode})) {
+        return;
+    }
+    glColorMaterial(face, mode);
+    colorMaterialMode = {face, mode};
+    // With GL_COLOR_MATERIAL on, the current color is applied to the new material right away
+    forgetMaterials();
+}
+
+void GLState::materialfv(GLenum face, GLenum name, const GLfloat *values) {
+    if (changeMaterial(face, name, values)) {
+        glMaterialfv(face, name, values);
+    }
+}
+
+void GLState::materialf(GLenum face, GLenum name, GLfloat value) {
+    if (changeMaterial(face, name, &value)) {
+        glMaterialf(face, name, value);
+    }
+}
+
+void GLState::matrixMode(GLenum mode) {
+    if (skip(currentMatrixMode == mode)) {
+        return;
+    }
+    glMatrixMode(mode);
+    currentMatrixMode = mode;
+}
+
+void GLState::loadIdentity() {
+    // Only the texture matrix is skipped, the others change all the time
+    const bool texture = currentMatrixMode == GL_TEXTURE;
+    if (skip(texture && textureIdentity)) {
+        return;
+    }
+    glLoadIdentity();
+    if (texture) {
+        textureIdentity = true;
+    } else if (inModelView()) {
+        modelViews.back() = IDENTITY;
+    }
+}
+
+void GLState::translated(GLdouble x, GLdouble y, GLdouble z) {
+    ++stats.issued;
+    glTranslated(x, y, z);
+    if (currentMatrixMode.value_or(GL_TEXTURE) == GL_TEXTURE) {
+        textureIdentity = false;
+    }
+    if (inModelView()) {
+        multiplyModelView({1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, x, y, z, 1});
+    }
+}
+
+void GLState::rotated(GLdouble angle, GLdouble x, GLdouble y, GLdouble z) {
+    ++stats.issued;
+    glRotated(angle, x, y, z);
+    const double length = std::sqrt(x * x + y * y + z * z);
+    if (!inModelView() || length == 0.0) {
+        return;
+    }
+    x /= length;
+    y /= length;
+    z /= length;
+    // As given in the glRotate reference
+    const double radians = angle * std::numbers::pi / 180.0;
+    const double c = std::cos(radians), s = std::sin(radians), t = 1.0 - c;
+    multiplyModelView({
+        x * x * t + c, y * x * t + z * s, x * z * t - y * s, 0,
+        x * y * t - z * s, y * y * t + c, y * z * t + x * s, 0,
+        x * z * t + y * s, y * z * t - x * s, z * z * t + c, 0,
+        0, 0, 0, 1,
+    });
+}
+
+void GLState::scaled(GLdouble x, GLdouble y, GLdouble z) {
+    ++stats.issued;
+    glScaled(x, y, z);
+    if (inModelView()) {
+        multiplyModelView({x, 0, 0, 0, 0, y, 0, 0, 0, 0, z, 0, 0, 0, 0, 1});
+    }
+}
+
+void GLState::multMatrixf(const GLfloat *matrix) {
+    ++stats.issued;
+    glMultMatrixf(matrix);
+    if (currentMatrixMode.value_or(GL_TEXTURE) == GL_TEXTURE) {
+        textureIdentity = false;
+    }
+    if (inModelView()) {
+        std::array<GLdouble, 16> right;
+        std::copy_n(matrix, 16, right.begin());
+        multiplyModelView(right);
+    }
+}
+
+void GLState::loadMatrixf(const GLfloat *matrix) {
+    ++stats.issued;
+    glLoadMatrixf(matrix);
+    if (currentMatrixMode.value_or(GL_TEXTURE) == GL_TEXTURE) {
+        textureIdentity = false;
+    }
+    if (inModelView()) {
+        std::copy_n(matrix, 16, modelViews.back().begin());
+    }
+}
+
+void GLState::pushMatrix() {
+    ++stats.issued;
+    glPushMatrix();
+    if (inModelView()) {
+        modelViews.push_back(modelViews.back());
+    }
+}
+
+void GLState::popMatrix() {
+    ++stats.issued;
+    glPopMatrix();
+    // Popping the last one is an error that GL ignores
+    if (inModelView() && modelViews.size() > 1) {
+        modelViews.pop_back();
+    }
+}
+
+const std::array<GLfloat, 16> &GLState::getModelView() {
+    return modelViews.back();
+}
+
+const GLState::View &GLState::getView() {
+    if (!view) {
+        view.emplace();
+        glGetDoublev(GL_PROJECTION_MATRIX, view->projection.data());
+        glGetIntegerv(GL_VIEWPORT, view->viewport.data());
+    }
+    return *view;
+}
+
+GLState::Stats GLState::endFrame() {
+    const Stats frame = stats;
+    stats = {};
+    view.reset();
+    return frame;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "freeglut.h"
+#include <array>
+#include <cstddef>
+
+// Stand-ins for the GL calls that change state, taking the same arguments. Each one remembers what
+// it set and skips calls that wouldn't change anything. Only state set through them is known, so
+// the render code makes these calls rather than the GL ones. Tracked are the capabilities the
+// renderer switches, the GL_TEXTURE_2D binding, the front materials, the matrix mode, whether
+// the texture matrix is the identity and the modelview matrix stack; anything else is passed on
+// as is. Code may still change the modelview matrix with the GL calls between a glPushMatrix and
+// a glPopMatrix of its own, as long as it doesn't read it through getModelView in between.
+namespace GLState {
+struct Stats {
+    std::size_t issued; // Passed on to GL
+    std::size_t elided; // Skipped, as they wouldn't have changed anything
+};
+
+void enable(GLenum capability);
+void disable(GLenum capability);
+void bindTexture(GLenum target, GLuint texture);
+// Deleting a bound texture binds 0 in its place
+void deleteTextures(GLsizei count, const GLuint *textures);
+void colorMaterial(GLenum face, GLenum mode);
+void materialfv(GLenum face, GLenum name, const GLfloat *values);
+void materialf(GLenum face, GLenum name, GLfloat value);
+void matrixMode(GLenum mode);
+void loadIdentity();
+// The one way the texture matrix may be changed other than loadIdentity
+void translated(GLdouble x, GLdouble y, GLdouble z);
+void rotated(GLdouble angle, GLdouble x, GLdouble y, GLdouble z);
+void scaled(GLdouble x, GLdouble y, GLdouble z);
+void multMatrixf(const GLfloat *matrix);
+void loadMatrixf(const GLfloat *matrix);
+void pushMatrix();
+void popMatrix();
+// The current modelview matrix, column-major like glGetFloatv(GL_MODELVIEW_MATRIX) returns it but
+// without waiting for GL
+const std::array<GLfloat, 16> &getModelView();
+
+// The projection matrix and the viewport, which aren't tracked: they are read back from GL the
+// first time they are asked for in a frame. That is what the scene is drawn with, as the overlays
+// only set their own while the render queue is drawing them.
+struct View {
+    std::array<GLdouble, 16> projection;
+    std::array<GLint, 4> viewport;
+};
+const View &getView();
+
+// Returns the calls made since the last time and starts counting again, once per frame
+Stats endFrame();
+}
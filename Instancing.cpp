@@ -0,0 +1,217 @@
+#include "Instancing.h"
+#include "BufferObjects.h"
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+namespace {
+
+constexpr GLenum FRAGMENT_SHADER{0x8B30};
+constexpr GLenum VERTEX_SHADER{0x8B31};
+constexpr GLenum COMPILE_STATUS{0x8B81};
+constexpr GLenum LINK_STATUS{0x8B82};
+constexpr GLenum INFO_LOG_LENGTH{0x8B84};
+
+// Generic attribute the instance offsets are read from. Attribute 0 aliases gl_Vertex on some
+// drivers, so stay clear of the low numbers.
+constexpr GLuint OFFSET_ATTRIBUTE{7};
+
+const char VERTEX_SOURCE[]{R"(#version 120
+uniform float scale;
+attribute vec3 instanceOffset;
+void main() {
+    gl_Position = gl_ModelViewProjectionMatrix * vec4(instanceOffset + scale * gl_Vertex.xyz, 1.0);
+    gl_TexCoord[0] = gl_TextureMatrix[0] * gl_MultiTexCoord0;
+    gl_FrontColor = gl_Color;
+}
+)"};
+
+// GL_MODULATE, the default texture environment
+const char FRAGMENT_SOURCE[]{R"(#version 120
+uniform sampler2D image;
+uniform bool textured;
+void main() {
+    gl_FragColor = textured ? texture2D(image, gl_TexCoord[0].st) * gl_Color : gl_Color;
+}
+)"};
+
+using CreateShader = GLuint(APIENTRY *)(GLenum type);
+using ShaderSource = void(APIENTRY *)(GLuint shader, GLsizei count, const char *const *sources,
+                                      const GLint *lengths);
+using CompileShader = void(APIENTRY *)(GLuint shader);
+using GetShaderiv = void(APIENTRY *)(GLuint shader, GLenum name, GLint *value);
+using GetShaderInfoLog = void(APIENTRY *)(GLuint shader, GLsizei size, GLsizei *length,
+                                          char *log);
+using DeleteShader = void(APIENTRY *)(GLuint shader);
+using CreateProgram = GLuint(APIENTRY *)();
+using AttachShader = void(APIENTRY *)(GLuint program, GLuint shader);
+using BindAttribLocation = void(APIENTRY *)(GLuint program, GLuint index, const char *name);
+using LinkProgram = void(APIENTRY *)(GLuint program);
+using UseProgram = void(APIENTRY *)(GLuint program);
+using GetUniformLocation = GLint(APIENTRY *)(GLuint program, const char *name);
+using Uniform1i = void(APIENTRY *)(GLint location, GLint value);
+using Uniform1f = void(APIENTRY *)(GLint location, GLfloat value);
+using EnableVertexAttribArray = void(APIENTRY *)(GLuint index);
+using VertexAttribPointer = void(APIENTRY *)(GLuint index, GLint size, GLenum type,
+                                             GLboolean normalized, GLsizei stride,
+                                             const void *pointer);
+using VertexAttribDivisor = void(APIENTRY *)(GLuint index, GLuint divisor);
+using DrawElementsInstanced = void(APIENTRY *)(GLenum mode, GLsizei count, GLenum type,
+                                               const void *indices, GLsizei instanceCount);
+
+CreateShader createShader{nullptr};
+ShaderSource shaderSource{nullptr};
+CompileShader compileShader{nullptr};
+GetShaderiv getShaderiv{nullptr};
+GetShaderInfoLog getShaderInfoLog{nullptr};
+DeleteShader deleteShader{nullptr};
+CreateProgram createProgram{nullptr};
+AttachShader attachShader{nullptr};
+BindAttribLocation bindAttribLocation{nullptr};
+LinkProgram linkProgram{nullptr};
+GetShaderiv getProgramiv{nullptr};
+GetShaderInfoLog getProgramInfoLog{nullptr};
+UseProgram useProgram{nullptr};
+GetUniformLocation getUniformLocation{nullptr};
+Uniform1i uniform1i{nullptr};
+Uniform1f uniform1f{nullptr};
+EnableVertexAttribArray enableVertexAttribArray{nullptr};
+EnableVertexAttribArray disableVertexAttribArray{nullptr};
+VertexAttribPointer vertexAttribPointer{nullptr};
+VertexAttribDivisor vertexAttribDivisor{nullptr};
+DrawElementsInstanced drawElementsInstanced{nullptr};
+
+GLuint program{0};
+GLint scaleUniform{-1};
+GLint texturedUniform{-1};
+
+// Tries the core name first and then, if there is one, the name it had in an ARB extension
+template <typename Function>
+void lookUp(Function &function, const char *name, const char *extensionName = nullptr) {
+    function = reinterpret_cast<Function>(glutGetProcAddress(name));
+    if (function == nullptr && extensionName != nullptr) {
+        function = reinterpret_cast<Function>(glutGetProcAddress(extensionName));
+    }
+}
+
+GLuint compile(GLenum type, const char *source) {
+    const GLuint shader = createShader(type);
+    shaderSource(shader, 1, &source, nullptr);
+    compileShader(shader);
+    GLint compiled = GL_FALSE;
+    getShaderiv(shader, COMPILE_STATUS, &compiled);
+    if (compiled != GL_TRUE) {
+        GLint length = 0;
+        getShaderiv(shader, INFO_LOG_LENGTH, &length);
+        std::string log(static_cast<std::size_t>(std::max(length, 1)), '\0');
+        getShaderInfoLog(shader, length, nullptr, log.data());
+        std::cerr << "Failed to compile the instancing shader: " << log << std::endl;
+        deleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+bool buildProgram() {
+    const GLuint vertexShader = compile(VERTEX_SHADER, VERTEX_SOURCE);
+    const GLuint fragmentShader = compile(FRAGMENT_SHADER, FRAGMENT_SOURCE);
+    if (vertexShader == 0 || fragmentShader == 0) {
+        return false;
+    }
+
+    program = createProgram();
+    attachShader(program, vertexShader);
+    attachShader(program, fragmentShader);
+    bindAttribLocation(program, OFFSET_ATTRIBUTE, "instanceOffset");
+    linkProgram(program);
+    // The program keeps them alive for as long as it needs them
+    deleteShader(vertexShader);
+    deleteShader(fragmentShader);
+
+    GLint linked = GL_FALSE;
+    getProgramiv(program, LINK_STATUS, &linked);
+    if (linked != GL_TRUE) {
+        GLint length = 0;
+        getProgramiv(program, INFO_LOG_LENGTH, &length);
+        std::string log(static_cast<std::size_t>(std::max(length, 1)), '\0');
+        getProgramInfoLog(program, length, nullptr, log.data());
+        std::cerr << "Failed to link the instancing shader: " << log << std::endl;
+        program = 0;
+        return false;
+    }
+
+    scaleUniform = getUniformLocation(program, "scale");
+    texturedUniform = getUniformLocation(program, "textured");
+    useProgram(program);
+    uniform1i(getUniformLocation(program, "image"), 0);
+    useProgram(0);
+    return true;
+}
+
+} // namespace
+
+bool Instancing::load() {
+    // The shader entry points are core since GL 2.0. ARB_shader_objects had other names and types
+    // for them (glCreateShaderObjectARB, GLhandleARB), so older drivers go without instancing.
+    lookUp(createShader, "glCreateShader");
+    lookUp(shaderSource, "glShaderSource");
+    lookUp(compileShader, "glCompileShader");
+    lookUp(getShaderiv, "glGetShaderiv");
+    lookUp(getShaderInfoLog, "glGetShaderInfoLog");
+    lookUp(deleteShader, "glDeleteShader");
+    lookUp(createProgram, "glCreateProgram");
+    lookUp(attachShader, "glAttachShader");
+    lookUp(bindAttribLocation, "glBindAttribLocation");
+    lookUp(linkProgram, "glLinkProgram");
+    lookUp(getProgramiv, "glGetProgramiv");
+    lookUp(getProgramInfoLog, "glGetProgramInfoLog");
+    lookUp(useProgram, "glUseProgram");
+    lookUp(getUniformLocation, "glGetUniformLocation");
+    lookUp(uniform1i, "glUniform1i");
+    lookUp(uniform1f, "glUniform1f");
+    lookUp(enableVertexAttribArray, "glEnableVertexAttribArray");
+    lookUp(disableVertexAttribArray, "glDisableVertexAttribArray");
+    lookUp(vertexAttribPointer, "glVertexAttribPointer");
+    // Core since GL 3.3 and 3.1, before that ARB_instanced_arrays and ARB_draw_instanced
+    lookUp(vertexAttribDivisor, "glVertexAttribDivisor", "glVertexAttribDivisorARB");
+    lookUp(drawElementsInstanced, "glDrawElementsInstanced", "glDrawElementsInstancedARB");
+
+    const bool found =
+        createShader && shaderSource && compileShader && getShaderiv && getShaderInfoLog &&
+        deleteShader && createProgram && attachShader && bindAttribLocation && linkProgram &&
+        getProgramiv && getProgramInfoLog && useProgram && getUniformLocation && uniform1i &&
+        uniform1f && enableVertexAttribArray && disableVertexAttribArray && vertexAttribPointer &&
+        vertexAttribDivisor && drawElementsInstanced;
+    return found && BufferObjects::isAvailable() && buildProgram();
+}
+
+bool Instancing::isAvailable() {
+    return program != 0;
+}
+
+void Instancing::begin(GLuint instances, float scale) {
+    useProgram(program);
+    uniform1f(scaleUniform, scale);
+    BufferObjects::bind(BufferObjects::ARRAY_BUFFER, instances);
+    enableVertexAttribArray(OFFSET_ATTRIBUTE);
+    vertexAttribPointer(OFFSET_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+    vertexAttribDivisor(OFFSET_ATTRIBUTE, 1);
+    BufferObjects::bind(BufferObjects::ARRAY_BUFFER, 0);
+}
+
+void Instancing::setTextured(bool textured) {
+    uniform1i(texturedUniform, textured ? 1 : 0);
+}
+
+void Instancing::drawElements(GLsizei count, GLenum type, std::size_t offset,
+                              GLsizei instanceCount) {
+    drawElementsInstanced(GL_TRIANGLES, count, type, reinterpret_cast<const void *>(offset),
+                          instanceCount);
+}
+
+void Instancing::end() {
+    vertexAttribDivisor(OFFSET_ATTRIBUTE, 0);
+    disableVertexAttribArray(OFFSET_ATTRIBUTE);
+    useProgram(0);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "freeglut.h"
+#include <cstddef>
+
+// Draws many copies of a mesh with one call per section (glDrawElementsInstanced), each copy moved
+// by its own offset read from a buffer object. The fixed function pipeline can't vary the
+// transform per instance, so this uses a small shader doing what the fixed function pipeline does
+// for the scene: texture times color, no lighting. The entry points are looked up at run time,
+// like BufferObjects.
+namespace Instancing {
+// Looks up the entry points and builds the shader. Call once the window exists and after
+// BufferObjects::load. Returns false if the driver can't draw instances.
+bool load();
+bool isAvailable();
+
+// Switches to the instancing shader. instances is a buffer object holding three floats (x, y, z)
+// per instance, which are added to the vertices after scaling them by scale.
+void begin(GLuint instances, float scale);
+// Whether the bound texture is applied, like enabling GL_TEXTURE_2D
+void setTextured(bool textured);
+// glDrawElements with the bound buffers, once per instance
+void drawElements(GLsizei count, GLenum type, std::size_t offset, GLsizei instanceCount);
+// Back to the fixed function pipeline
+void end();
+}
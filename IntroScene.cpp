@@ -1,14 +1,20 @@
 #include "IntroScene.h"
+#include "GLState.h"
+#include "ModelRegistry.h"
+#include "RenderQueue.h"
 #include "WorldScene.h"
 #include "freeglut.h"
-#include "TextureLoader.h"
+#include "TextureCache.h"
+#include "Trace.h"
 
 void IntroScene::initialize() {
     // Dialga
-    dialga.loadFromFile("./assets/art/models/title-screen-dialga/Dialga.obj");
-    dialga.setGroupWithScrollingTexture("iar_skin", 0.0, -0.2);
+    dialga =
+        ModelRegistry::getInstance().load("./assets/art/models/title-screen-dialga/Dialga.obj");
+    dialga->setGroupWithScrollingTexture("iar_skin", 0.0, -0.2);
     // Pokemon logo
-    pokemonLogoTexture = TextureLoader::loadTexture("./assets/pokemon-diamond-logo-big.png");
+    pokemonLogoTexture =
+        TextureCache::getInstance().acquire("./assets/pokemon-diamond-logo-big.png");
     // Audio
     audioEngine.initialize();
     audioEngine.playMusic("./assets/audio/music/title-screen.mp3");
@@ -28,27 +34,38 @@ void IntroScene::registerInputCallbacks() {
 void IntroScene::render() {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
+    GLState::matrixMode(GL_MODELVIEW);
+    GLState::loadIdentity();
 
     // Render Dialga
-    glPushMatrix();
-    glRotated(-40, 0.0, 1.0, 0.0);
-    glTranslated(0.4, -1.0, 0.0);
-    glScaled(0.01, 0.01, 0.01);
-    dialga.render();
-    glPopMatrix();
+    GLState::pushMatrix();
+    GLState::rotated(-40, 0.0, 1.0, 0.0);
+    GLState::translated(0.4, -1.0, 0.0);
+    GLState::scaled(0.01, 0.01, 0.01);
+    dialga->render();
+    GLState::popMatrix();
+
+    auto &queue = RenderQueue::getInstance();
+    queue.submitCustom(RenderQueue::Pass::Overlay, RenderQueue::Shader::FixedFunction,
+                       [](const void *scene, std::uintptr_t) {
+                           static_cast<const IntroScene *>(scene)->drawTitle();
+                       },
+                       this);
+    queue.flush();
+    glutSwapBuffers();
+}
 
+void IntroScene::drawTitle() const {
     // Render Pokemon logo
     glPushMatrix();
-    glEnable(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, pokemonLogoTexture);
+    GLState::enable(GL_TEXTURE_2D);
+    GLState::bindTexture(GL_TEXTURE_2D, pokemonLogoTexture);
     glColor3d(1.0, 1.0, 1.0);
 
-    glDisable(GL_DEPTH_TEST);
+    GLState::disable(GL_DEPTH_TEST);
     glDepthMask(GL_FALSE);
     // Alpha blending
-    glEnable(GL_BLEND);
+    GLState::enable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     glTranslated(-1.15, 0.5, 0);
@@ -68,10 +85,10 @@ void IntroScene::render() {
     glVertex2f(-width / 2, height / 2);
     glEnd();
 
-    glDisable(GL_TEXTURE_2D);
-    glDisable(GL_BLEND);
+    GLState::disable(GL_TEXTURE_2D);
+    GLState::disable(GL_BLEND);
     glDepthMask(GL_TRUE);
-    glEnable(GL_DEPTH_TEST);
+    GLState::enable(GL_DEPTH_TEST);
     glPopMatrix();
 
     // Render text
@@ -81,17 +98,23 @@ void IntroScene::render() {
     const unsigned char *text = reinterpret_cast<const unsigned char *>("Press the C Button");
     glutBitmapString(GLUT_BITMAP_HELVETICA_18, text);
     glPopMatrix();
-
-    glutSwapBuffers();
 }
 
 void IntroScene::update(double deltaTime) {
-    dialga.update(deltaTime);
+    dialga->update(deltaTime);
 }
 
 extern Scene *scene;
 void IntroScene::keyboardCallback(unsigned char key, int x, int y) {
     switch (key) {
+    case 't':
+    case 'T':
+        Trace::getInstance().save();
+        break;
+    case 's':
+    case 'S':
+        RenderQueue::getInstance().printStats();
+        break;
     case 13: // Enter key
     case 'c':
     case 'C':
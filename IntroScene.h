@@ -2,6 +2,7 @@
 
 #include "Object.h"
 #include "Scene.h"
+#include <memory>
 
 class IntroScene : public Scene {
   public:
@@ -19,6 +20,8 @@ class IntroScene : public Scene {
 
   private:
     IntroScene() = default; // Private constructor for singleton
-    Object dialga;
+    // Draws the logo and the prompt over Dialga
+    void drawTitle() const;
+    std::shared_ptr<Object> dialga;
     GLuint pokemonLogoTexture;
 };
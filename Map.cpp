@@ -1,275 +1,490 @@
 #include "Map.h"
+#include "AssetStreamer.h"
+#include "BufferObjects.h"
+#include "Frustum.h"
+#include "GLState.h"
+#include "ModelRegistry.h"
+#include "RenderQueue.h"
 #include "Tile.h"
+#include "Trace.h"
+#include "VirtualFileSystem.h"
 #include "glig.h"
-#include <fstream>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <numbers>
 #include <sstream>
 
+namespace {
+
+// Lowest point of the terrain, the bottom of the lakes
+constexpr double TERRAIN_BOTTOM{-0.5625};
+// Higher than any model placed on a map, for the bounds of the chunks
+constexpr double OBJECT_HEIGHT{8.0};
+// How far a model may reach outside the tiles it covers
+constexpr double OBJECT_MARGIN{0.5};
+
+// glTranslated(x, y, z), glRotated(angle, 0, 1, 0) and glScaled(scale, scale, scale) in one
+// column major matrix
+std::array<GLfloat, 16> makeWorldMatrix(double x, double y, double z, double angle,
+                                        double scale) {
+    const double radians = angle * std::numbers::pi / 180.0;
+    const auto cosine = static_cast<GLfloat>(std::cos(radians) * scale);
+    const auto sine = static_cast<GLfloat>(std::sin(radians) * scale);
+    const auto size = static_cast<GLfloat>(scale);
+    return {cosine, 0.0f, -sine, 0.0f, 0.0f, size, 0.0f, 0.0f, sine, 0.0f, cosine, 0.0f,
+            static_cast<GLfloat>(x), static_cast<GLfloat>(y), static_cast<GLfloat>(z), 1.0f};
+}
+
+// Codes 121 to 129 of the objects layer are fences, 100 more than their ModelType. Returns the
+// angle the fence is turned by, or a negative number if the code isn't a fence.
+double getFenceAngle(ModelType fenceType) {
+    using enum ModelType;
+    switch (fenceType) {
+    case FenceH:
+    case FenceTL:
+        return 0.0;
+    case FenceV:
+    case FenceBL:
+        return 90.0;
+    case FenceBR:
+        return 180.0;
+    case FenceTR:
+        return 270.0;
+    default:
+        return -1.0;
+    }
+}
+
+} // namespace
+
 Map::Map() {
-    // Load models in constructor
-    house.loadFromFile("./assets/art/models/twinleaf-town-small-house/twinleaf-town-small-house.obj");
-    tree.loadFromFile("./assets/art/models/pine-tree/pine-tree.obj");
-    flower.loadFromFile("./assets/art/models/flower/flower.obj");
-    grass.loadFromFile("./assets/art/models/grass/grass.obj");
-    woodenSign.loadFromFile("./assets/art/models/wooden-sign/wooden-sign.obj");
-    mailbox.loadFromFile("./assets/art/models/mailbox/mailbox.obj");
-    pokemonCenter.loadFromFile("./assets/art/models/pokemon-center/pokemon-center.obj");
-    pokeMart.loadFromFile("./assets/art/models/poke-mart/poke-mart.obj");
-    pokemonResearchLab.loadFromFile(
-        "./assets/art/models/pokemon-research-lab/pokemon-research-lab.obj");
+    // Request the models in the constructor. They stream in while the map is already rendering.
+    auto &models = ModelRegistry::getInstance();
+    house = models.loadAsync(
+        "./assets/art/models/twinleaf-town-small-house/twinleaf-town-small-house.obj");
+    tree = models.loadAsync("./assets/art/models/pine-tree/pine-tree.obj");
+    flower = models.loadAsync("./assets/art/models/flower/flower.obj");
+    grass = models.loadAsync("./assets/art/models/grass/grass.obj");
+    woodenSign = models.loadAsync("./assets/art/models/wooden-sign/wooden-sign.obj");
+    mailbox = models.loadAsync("./assets/art/models/mailbox/mailbox.obj");
+    pokemonCenter = models.loadAsync("./assets/art/models/pokemon-center/pokemon-center.obj");
+    pokeMart = models.loadAsync("./assets/art/models/poke-mart/poke-mart.obj");
+    pokemonResearchLab =
+        models.loadAsync("./assets/art/models/pokemon-research-lab/pokemon-research-lab.obj");
+
+    buildings = {
+        {ModelType::House, 130, house.get(), 0.0, 4, 3, 1.5, 1.0},
+        {ModelType::PokemonResearchLab, 160, pokemonResearchLab.get(), 8.0, 8, 5, 3.0, 2.0},
+        {ModelType::PokemonCenter, 180, pokemonCenter.get(), 5.0, 5, 3, 2.0, 1.0},
+        {ModelType::PokeMart, 181, pokeMart.get(), 4.0, 4, 3, 1.55, 1.0},
+    };
+    props = {
+        {1, grass.get(), 1.0, 1, 0.0},        // Tall grass -> 1x1
+        {30, flower.get(), 1.0, 1, 0.0},      // Flowers -> 1x1
+        {100, tree.get(), 2.0, 2, 0.5},       // Trees -> 2x2
+        {200, woodenSign.get(), 1.0, 1, 0.0}, // Sign -> 1x1
+        {210, mailbox.get(), 1.0, 1, 0.0},    // Mailbox -> 1x1
+    };
 }
 
 void Map::loadMap(const std::string &mapName) {
-    loadTerrain("./assets/" + mapName + " - Terrain.txt");
-    loadMapObjects("./assets/" + mapName + " - Objects.txt");
-    loadEvents("./assets/" + mapName + " - Events.txt");
+    this->mapName = mapName;
+    const std::string terrainPath = "./assets/" + mapName + " - Terrain.txt";
+    const std::string objectsPath = "./assets/" + mapName + " - Objects.txt";
+    const std::string eventsPath = "./assets/" + mapName + " - Events.txt";
+    loadTerrain(terrainPath);
+    loadMapObjects(objectsPath);
+    loadEvents(eventsPath);
+    buildChunks();
+
+    for (const auto watch : layerWatches) {
+        FileWatcher::getInstance().unwatch(watch);
+    }
+    layerWatches.clear();
+    watchLayer(terrainPath, "terrain", terrain);
+    watchLayer(objectsPath, "objects", objects);
+    watchLayer(eventsPath, "events", events);
 }
 
 void Map::loadTerrain(const std::string &mapPath) {
-    std::ifstream inputFile(mapPath);
-    if (!inputFile.is_open()) {
-        std::cerr << "Error opening terrain file: " << mapPath << std::endl;
-        return;
-    }
+    parseLayer(mapPath, "terrain", terrain);
+}
 
-    terrain.clear();
-    std::string row;
-    while (std::getline(inputFile, row)) {
-        if (!row.empty()) {
-            std::istringstream tilesStream(row);
-            std::vector<std::string> currentRow;
-            std::string tile;
+void Map::loadMapObjects(const std::string &mapPath) {
+    parseLayer(mapPath, "objects", objects);
+}
 
-            while (tilesStream >> tile) {
-                currentRow.push_back(tile);
+void Map::buildChunks() {
+    TRACE_SCOPE("Build map chunks");
+    releaseChunks();
+    const std::size_t rows = std::max(terrain.size(), objects.size());
+    std::size_t columns = 0;
+    for (const Layer *layer : {&terrain, &objects}) {
+        for (const auto &row : *layer) {
+            columns = std::max(columns, row.size());
+        }
+    }
+    chunkColumns = (columns + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    const std::size_t chunkRows = (rows + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    // Chunks own buffers and can't be moved, so the old ones are swapped out whole
+    std::vector<Chunk>(chunkRows * chunkColumns).swap(chunks);
+    for (std::size_t index = 0; index < chunks.size(); ++index) {
+        Chunk &chunk = chunks[index];
+        chunk.firstRow = index / chunkColumns * CHUNK_SIZE;
+        chunk.firstColumn = index % chunkColumns * CHUNK_SIZE;
+        // Tiles are centered on their row and column
+        const double left = chunk.firstColumn - 0.5;
+        const double top = chunk.firstRow - 0.5;
+        chunk.bounds = {{left, TERRAIN_BOTTOM, top}, {left + CHUNK_SIZE, 0.0, top + CHUNK_SIZE}};
+        chunk.props.resize(props.size());
+    }
+
+    // Tiles already covered by a larger object, like the rest of a tree
+    std::vector<std::vector<bool>> covered(objects.size());
+    for (std::size_t i = 0; i < objects.size(); ++i) {
+        covered[i].assign(objects[i].size(), false);
+    }
+    for (std::size_t i = 0; i < objects.size(); ++i) {
+        for (std::size_t j = 0; j < objects[i].size(); ++j) {
+            if (covered[i][j]) {
+                continue;
+            }
+            const int objectId = std::stoi(objects[i][j]);
+            Chunk &chunk = chunks[i / CHUNK_SIZE * chunkColumns + j / CHUNK_SIZE];
+            int width, height;
+            const auto prop = std::ranges::find(props, objectId, &Prop::objectId);
+            if (prop != props.end()) {
+                auto &offsets = chunk.props[prop - props.begin()].offsets;
+                offsets.insert(offsets.end(), {static_cast<GLfloat>(j + prop->centerOffset), 0.0f,
+                                               static_cast<GLfloat>(i + prop->centerOffset)});
+                width = height = prop->footprint;
+            } else {
+                Placement placement;
+                if (!resolvePlacement(objectId, i, j, placement)) {
+                    continue;
+                }
+                width = placement.footprintWidth;
+                height = placement.footprintHeight;
+                chunk.objects.push_back(placement);
             }
 
-            terrain.push_back(currentRow);
+            const auto coveredRows = static_cast<std::size_t>(height);
+            const auto coveredColumns = static_cast<std::size_t>(width);
+            for (std::size_t di = 0; di < coveredRows && i + di < objects.size(); ++di) {
+                for (std::size_t dj = 0; dj < coveredColumns && j + dj < objects[i + di].size();
+                     ++dj) {
+                    covered[i + di][j + dj] = true;
+                }
+            }
+            // The model may reach into the next chunks, which don't know about it
+            auto &bounds = chunk.bounds;
+            bounds.min.x = std::min(bounds.min.x, j - 0.5 - OBJECT_MARGIN);
+            bounds.min.z = std::min(bounds.min.z, i - 0.5 - OBJECT_MARGIN);
+            bounds.max.x = std::max(bounds.max.x, j + width - 0.5 + OBJECT_MARGIN);
+            bounds.max.z = std::max(bounds.max.z, i + height - 0.5 + OBJECT_MARGIN);
+            bounds.max.y = OBJECT_HEIGHT;
         }
     }
-
-    inputFile.close();
 }
 
-void Map::loadMapObjects(const std::string &mapPath) {
-    std::ifstream inputFile(mapPath);
-    if (!inputFile.is_open()) {
-        std::cerr << "Error opening objects file: " << mapPath << std::endl;
-        return;
+bool Map::resolvePlacement(int objectId, std::size_t i, std::size_t j,
+                           Placement &placement) const {
+    const auto building = std::ranges::find(buildings, objectId, &Building::objectId);
+    if (building != buildings.end()) {
+        placement = {building->type,
+                     makeWorldMatrix(j + building->centerX, 0.0, i + building->centerZ, 0.0,
+                                     building->scale),
+                     building->footprintWidth, building->footprintHeight};
+        return true;
     }
 
-    objects.clear();
-    std::string row;
-    while (std::getline(inputFile, row)) {
-        if (!row.empty()) {
-            std::istringstream tilesStream(row);
-            std::vector<std::string> currentRow;
-            std::string tile;
-            // TODO: Change to enum
-            while (tilesStream >> tile) {
-                currentRow.push_back(tile);
+    const auto fenceType = static_cast<ModelType>(objectId - 100);
+    const double angle = getFenceAngle(fenceType);
+    if (angle < 0.0) {
+        return false;
+    }
+    placement = {fenceType, makeWorldMatrix(j, 0.375, i, angle, 1.0), 1, 1};
+    return true;
+}
+
+void Map::updateBuildingScales() {
+    for (auto &building : buildings) {
+        double scale = 1.0;
+        if (building.model->isLoaded() && building.targetSize != 0.0) {
+            scale = building.model->calculateScaleFactor(building.targetSize);
+        }
+        if (scale == building.scale) {
+            continue;
+        }
+        building.scale = scale;
+        for (auto &chunk : chunks) {
+            for (auto &placement : chunk.objects) {
+                if (placement.model == building.type) {
+                    const auto &matrix = placement.matrix;
+                    placement.matrix =
+                        makeWorldMatrix(matrix[12], matrix[13], matrix[14], 0.0, scale);
+                }
             }
+        }
+    }
+}
 
-            objects.push_back(currentRow);
+void Map::releaseChunks() {
+    for (auto &chunk : chunks) {
+        chunk.terrain.release();
+        for (auto &instances : chunk.props) {
+            if (instances.instanceBuffer != 0) {
+                BufferObjects::destroy(instances.instanceBuffer);
+                instances.instanceBuffer = 0;
+            }
         }
     }
+    visibleChunks.clear();
+}
 
-    inputFile.close();
+void Map::makeSynthetic(std::size_t size) {
+    TRACE_SCOPE("Make synthetic map");
+    for (Layer *layer : {&terrain, &objects, &events}) {
+        if (layer->empty()) {
+            continue;
+        }
+        Layer repeated(size, std::vector<std::string>(size));
+        for (std::size_t i = 0; i < size; ++i) {
+            const auto &row = (*layer)[i % layer->size()];
+            for (std::size_t j = 0; j < size && !row.empty(); ++j) {
+                repeated[i][j] = row[j % row.size()];
+            }
+        }
+        *layer = std::move(repeated);
+    }
+    buildChunks();
+    ++revision;
+    std::cout << "Made a synthetic " << size << "x" << size << " map (" << chunks.size()
+              << " chunks)" << std::endl;
 }
 
 void Map::loadEvents(const std::string &eventsPath) {
-    std::ifstream inputFile(eventsPath);
-    if (!inputFile.is_open()) {
-        std::cerr << "Error opening events file: " << eventsPath << std::endl;
-        return;
+    parseLayer(eventsPath, "events", events);
+}
+
+bool Map::parseLayer(const std::string &path, const char *what, Layer &layer) {
+    TRACE_SCOPE("Parse map layer", path);
+    AssetFile file;
+    if (!VirtualFileSystem::getInstance().open(path, file)) {
+        std::cerr << "Error opening " << what << " file: " << path << std::endl;
+        return false;
     }
-    events.clear();
+    std::istringstream inputFile{std::string(file.view())};
+
+    layer.clear();
     std::string row;
     while (std::getline(inputFile, row)) {
         if (!row.empty()) {
             std::istringstream tilesStream(row);
             std::vector<std::string> currentRow;
             std::string tile;
+
             while (tilesStream >> tile) {
                 currentRow.push_back(tile);
             }
-            events.push_back(currentRow);
+
+            layer.push_back(currentRow);
         }
     }
-    inputFile.close();
+    return true;
+}
+
+void Map::watchLayer(const std::string &path, const char *what, Layer &layer) {
+    const auto watch = FileWatcher::getInstance().watch(path, [this, path, what, &layer] {
+        auto parsed = std::make_shared<Layer>();
+        AssetStreamer::getInstance().enqueue(
+            [parsed, path, what] { parseLayer(path, what, *parsed); },
+            [this, parsed, &layer, mapName = mapName] {
+                // Drop it if the player changed maps meanwhile or the file was caught mid-save
+                if (mapName == this->mapName && !parsed->empty()) {
+                    layer = std::move(*parsed);
+                    if (&layer != &events) {
+                        buildChunks();
+                    }
+                    ++revision;
+                }
+            });
+    });
+    if (watch != 0) {
+        layerWatches.push_back(watch);
+    }
 }
 
 void Map::render() {
+    // Chunks outside the view volume are skipped altogether
+    const Frustum frustum = Frustum::fromCurrentMatrices();
+    visibleChunks.clear();
+    for (auto &chunk : chunks) {
+        if (frustum.intersects(chunk.bounds)) {
+            visibleChunks.push_back(&chunk);
+        }
+    }
+
     renderTerrain();
+    renderProps();
     renderObjects();
 }
 
+void Map::renderProps() {
+    for (std::size_t k = 0; k < props.size(); ++k) {
+        Prop &prop = props[k];
+        const bool instanced = prop.model->canRenderInstances();
+        if (instanced) {
+            prop.scale = prop.model->calculateScaleFactor(prop.targetSize);
+        }
+        for (Chunk *chunk : visibleChunks) {
+            auto &instances = chunk->props[k];
+            const auto count = static_cast<GLsizei>(instances.offsets.size() / 3);
+            if (count == 0) {
+                continue;
+            }
+            if (instanced) {
+                if (instances.instanceBuffer == 0) {
+                    instances.instanceBuffer = BufferObjects::create();
+                    BufferObjects::bind(BufferObjects::ARRAY_BUFFER, instances.instanceBuffer);
+                    BufferObjects::upload(BufferObjects::ARRAY_BUFFER,
+                                          instances.offsets.size() * sizeof(GLfloat),
+                                          instances.offsets.data());
+                    BufferObjects::bind(BufferObjects::ARRAY_BUFFER, 0);
+                }
+                // The instancing shader sets its own state
+                RenderQueue::getInstance().submitCustom(
+                    RenderQueue::Pass::Opaque, RenderQueue::Shader::Instancing,
+                    [](const void *owner, std::uintptr_t argument) {
+                        const Prop &prop = *static_cast<const Prop *>(owner);
+                        const auto &instances = *reinterpret_cast<const PropInstances *>(argument);
+                        prop.model->renderInstances(
+                            instances.instanceBuffer,
+                            static_cast<GLsizei>(instances.offsets.size() / 3), prop.scale);
+                    },
+                    &prop, reinterpret_cast<std::uintptr_t>(&instances));
+                continue;
+            }
+
+            // One at a time, like every other object
+            for (GLsizei n = 0; n < count; ++n) {
+                const GLfloat *offset = &instances.offsets[3 * n];
+                renderMapObject(*prop.model, prop.targetSize, offset[0], offset[1], offset[2],
+                                prop.footprint, prop.footprint);
+            }
+        }
+    }
+}
+
 void Map::renderTerrain() {
-    glPushMatrix();
-    for (int i = 0; i < terrain.size(); i++) {
-        glPushMatrix();
-        for (int j = 0; j < terrain[i].size(); j++) {
-            Tile::render(std::stoi(terrain[i][j]));
-            glTranslated(1.0, 0.0, 0.0);
+    // Every tile texture lives in the one atlas
+    const GLuint atlas = Tile::getAtlas();
+    for (Chunk *chunk : visibleChunks) {
+        // Baked the first time it is in view, and again whenever the atlas is laid out anew, as
+        // the texture coordinates point into it
+        auto &mesh = chunk->terrain;
+        if (!mesh.isBuilt() || mesh.getAtlasRevision() != Tile::getAtlasRevision()) {
+            mesh.build(terrain, chunk->firstRow, chunk->firstColumn, CHUNK_SIZE);
         }
-        glPopMatrix();
-        glTranslated(0.0, 0.0, 1.0);
+        mesh.render(atlas);
     }
-    glPopMatrix();
 }
 
 void Map::renderObjects() {
-    glPushMatrix();
-    std::vector<std::vector<std::string>> objects_copy = objects; // Deep copy
-
-    for (int i = 0; i < objects.size(); i++) {
-        for (int j = 0; j < objects[i].size(); j++) {
-            int objectId = std::stoi(objects_copy[i][j]);
-            switch (objectId) {
-            // No collision
-            // Tall grass -> 1x1
-            case 1:
-                renderMapObject(grass, 1.0, 1.0 * j, 0.0, 1.0 * i, 1, 1, objects_copy, i, j);
-                break;
-            // Flowers -> 1x1
-            case 30:
-                renderMapObject(flower, 1.0, 1.0 * j, 0.0, 1.0 * i, 1, 1, objects_copy, i, j);
-                break;
-            // Edges (jumps) -> 1x1
-            case 50: // Edges
-                // renderMapObject(edge, 1.0, 1.0 * j, 0.0, 1.0 * i, 1, 1, objects_copy, i, j);
-                break;
-
-            // With collision
-            // Trees -> 2x2
-            case 100:
-                renderMapObject(tree, 2.0, 1.0 * j + 0.5, 0.0, 1.0 * i + 0.5, 2, 2, objects_copy, i,
-                                j);
-                break;
-            // Fences -> 1x1
-            case 122:
-                renderFence(ModelType::FenceH, j, 0.0, i);
-                break;
-            case 124:
-                renderFence(ModelType::FenceV, j, 0.0, i);
-                break;
-            case 127:
-                renderFence(ModelType::FenceTL, j, 0.0, i);
-                break;
-            case 129:
-                renderFence(ModelType::FenceTR, j, 0.0, i);
-                break;
-            case 121:
-                renderFence(ModelType::FenceBL, j, 0.0, i);
-                break;
-            case 123:
-                renderFence(ModelType::FenceBR, j, 0.0, i);
-                break;
-            // Houses
-            case 130: // 4x3
-                renderMapObject(house, NULL, 1.0 * j + 1.5, 0.0, 1.0 * i + 1, 4, 3, objects_copy, i, j);
-                break;
-            // Pokemon Research Lab -> 8x5
-            case 160:
-                renderMapObject(pokemonResearchLab, 8.0, 1.0 * j + 3.0, 0.0, 1.0 * i + 2, 8, 5,
-                                objects_copy, i, j);
-                break;
-            // Pokemon Center -> 5x3
-            case 180:
-                renderMapObject(pokemonCenter, 5.0, 1.0 * j + 2.0, 0.0, 1.0 * i + 1, 5, 3,
-                                objects_copy, i, j);
-                break;
-            // Poke Mart -> 4x3
-            case 181:
-                renderMapObject(pokeMart, 4.0, 1.0 * j + 1.55, 0.0, 1.0 * i + 1, 4, 3,
-                                objects_copy, i, j);
-                break;
-            // Sign -> 1x1
-            case 200:
-                renderMapObject(woodenSign, 1.0, 1.0 * j, 0.0, 1.0 * i, 1, 1, objects_copy, i, j);
-                break;
-            // Mailbox -> 1x1
-            case 210:
-                renderMapObject(mailbox, 1.0, 1.0 * j, 0.0, 1.0 * i, 1, 1, objects_copy, i, j);
-                break;
+    updateBuildingScales();
+    // Grass, flowers, trees, signs and mailboxes are drawn by renderProps
+    for (const Chunk *chunk : visibleChunks) {
+        for (const auto &placement : chunk->objects) {
+            GLState::pushMatrix();
+            GLState::multMatrixf(placement.matrix.data());
+            const auto building = std::ranges::find(buildings, placement.model, &Building::type);
+            if (building == buildings.end()) {
+                renderFence(placement.model);
+            } else if (building->model->isLoaded()) {
+                building->model->render();
+            } else {
+                renderPlaceholder(placement.footprintWidth, placement.footprintHeight);
             }
+            GLState::popMatrix();
         }
     }
-    glPopMatrix();
 }
 
 void Map::renderMapObject(Object &object, double targetSize, double x, double y, double z,
-                          int footprintWidth, int footprintHeight,
-                          std::vector<std::vector<std::string>> &objects_copy, int i, int j) {
-    glPushMatrix();
-
-    double scale = 1.0;
-    // Calculate scale factor
-    if (targetSize != NULL) {
-        scale = object.calculateScaleFactor(targetSize);
-    }
+                          int footprintWidth, int footprintHeight) {
+    GLState::pushMatrix();
 
-    // Translate to grid position
-    glTranslated(x, y, z);
+    if (object.isLoaded()) {
+        double scale = 1.0;
+        // Calculate scale factor
+        if (targetSize != 0.0) {
+            scale = object.calculateScaleFactor(targetSize);
+        }
 
-    // Apply scaling
-    glScaled(scale, scale, scale);
+        // Translate to grid position
+        GLState::translated(x, y, z);
 
-    // Render the model
-    object.render();
+        // Apply scaling
+        GLState::scaled(scale, scale, scale);
 
-    // Mark the grid footprint as used
-    for (int dx = 0; dx < footprintHeight; ++dx) {
-        for (int dy = 0; dy < footprintWidth; ++dy) {
-            objects_copy[i + dx][j + dy] = "0";
-        }
+        // Render the model
+        object.render();
+    } else {
+        GLState::translated(x, y, z);
+        renderPlaceholder(footprintWidth, footprintHeight);
     }
 
-    glPopMatrix();
+    GLState::popMatrix();
 }
 
-void Map::renderFence(ModelType fenceType, double x, double y, double z) {
-    glPushMatrix();
-    glTranslated(0.0, 0.375, 0.0);
-    glTranslated(x, y, z);
-
-    using enum ModelType;
-    switch (fenceType) {
-    case FenceV:
-    case FenceBL:
-        glRotated(90, 0.0, 1.0, 0.0);
-        break;
-    case FenceBR:
-        glRotated(180, 0.0, 1.0, 0.0);
-        break;
-    case FenceTR:
-        glRotated(270, 0.0, 1.0, 0.0);
-        break;
-    }
+void Map::renderPlaceholder(int footprintWidth, int footprintHeight) {
+    RenderQueue::getInstance().submit(
+        RenderQueue::Pass::Opaque, {},
+        [](const void *, std::uintptr_t footprint) {
+            glPushMatrix();
+            glTranslated(0.0, 0.25, 0.0);
+            glColor3ub(160, 160, 160);
+            igSolidCube(0.9 * (footprint >> 16), 0.5, 0.9 * (footprint & 0xFFFF));
+            glColor3ub(255, 255, 255);
+            glPopMatrix();
+        },
+        nullptr, static_cast<std::uintptr_t>(footprintWidth) << 16 | footprintHeight);
+}
 
-    switch (fenceType) {
-    case FenceH: // Default
-    case FenceV:
-        glColor3d(1.0, 1.0, 1.0);
-        igSolidCube(0.33, 0.75, 0.33); // Vertical post
-        glColor3d(0.8, 0.8, 0.8);
-        igSolidCube(1.0, 0.25, 0.20); // Horizontal plank
-        break;
+void Map::renderFence(ModelType fenceType) {
+    RenderQueue::getInstance().submit(
+        RenderQueue::Pass::Opaque, {},
+        [](const void *, std::uintptr_t type) {
+            glPushMatrix();
+            using enum ModelType;
+            switch (static_cast<ModelType>(type)) {
+            case FenceH: // Default
+            case FenceV:
+                glColor3d(1.0, 1.0, 1.0);
+                igSolidCube(0.33, 0.75, 0.33); // Vertical post
+                glColor3d(0.8, 0.8, 0.8);
+                igSolidCube(1.0, 0.25, 0.20); // Horizontal plank
+                break;
 
-    case FenceTL: // Default
-    case FenceTR:
-    case FenceBL:
-    case FenceBR:
-        glColor3d(1.0, 1.0, 1.0);
-        igSolidCube(0.33, 0.75, 0.33); // Vertical post
-        glColor3d(0.8, 0.8, 0.8);
-        glTranslated(0.25, 0.0, 0.0);
-        igSolidCube(0.5, 0.25, 0.20); // Horizontal plank
-        glTranslated(-0.25, 0.0, 0.25);
-        glRotated(90, 0.0, 1.0, 0.0); // Rotate for corner
-        igSolidCube(0.5, 0.25, 0.20); // Vertical plank
-        break;
-    }
+            case FenceTL: // Default
+            case FenceTR:
+            case FenceBL:
+            case FenceBR:
+                glColor3d(1.0, 1.0, 1.0);
+                igSolidCube(0.33, 0.75, 0.33); // Vertical post
+                glColor3d(0.8, 0.8, 0.8);
+                glTranslated(0.25, 0.0, 0.0);
+                igSolidCube(0.5, 0.25, 0.20); // Horizontal plank
+                glTranslated(-0.25, 0.0, 0.25);
+                glRotated(90, 0.0, 1.0, 0.0); // Rotate for corner
+                igSolidCube(0.5, 0.25, 0.20); // Vertical plank
+                break;
 
-    glPopMatrix();
+            default:
+                break;
+            }
+            glPopMatrix();
+        },
+        nullptr, static_cast<std::uintptr_t>(fenceType));
 }
@@ -1,45 +1,139 @@
 #pragma once
 
+#include "FileWatcher.h"
 #include "ModelType.h"
 #include "Object.h"
+#include "TerrainMesh.h"
+#include <array>
+#include <cstddef>
+#include <memory>
 #include <string>
 #include <vector>
 
 class Map {
   public:
+    // Rows of whitespace separated tile codes, as read from a layer file
+    using Layer = std::vector<std::vector<std::string>>;
+
     Map();
 
     void loadMap(const std::string &mapName);
     void loadTerrain(const std::string &mapPath);
     void loadMapObjects(const std::string &objectsPath);
     void loadEvents(const std::string &eventsPath);
+    // Submits the chunks inside the view volume of the current projection and modelview matrices
+    // to the render queue
     void render();
 
+    // Tiles along each side of a chunk
+    static constexpr std::size_t CHUNK_SIZE{16};
+    struct ChunkStats {
+        std::size_t drawn;
+        std::size_t total;
+    };
+    // Of the last render
+    ChunkStats getChunkStats() const {
+        return {visibleChunks.size(), chunks.size()};
+    }
+    // Repeats the loaded layers until they are size by size tiles, to see how a large map holds up
+    void makeSynthetic(std::size_t size);
+
     const std::vector<std::vector<std::string>> &getCollisionMap() const {
         return objects;
     }
     const std::vector<std::vector<std::string>> &getEvents() const {
         return events;
     }
+    // Goes up every time a layer is reloaded after its file changed on disk, so whoever keeps a
+    // copy of the collision or event map knows to fetch it again
+    std::size_t getRevision() const {
+        return revision;
+    }
 
   private:
+    // A prop repeated all over the map, like grass or trees. Its copies in a chunk are drawn with
+    // one instanced call per section, or one by one where instancing isn't available.
+    struct Prop {
+        int objectId;        // Code in the objects layer
+        Object *model;       // Owned by one of the shared pointers below
+        double targetSize;
+        int footprint;       // Tiles covered in each direction
+        double centerOffset; // From the top left tile to the center of the footprint
+        double scale{1.0};   // Of the instanced copies, worked out every frame
+    };
+    // The copies of one prop in a chunk
+    struct PropInstances {
+        std::vector<GLfloat> offsets; // x, y, z of every copy
+        GLuint instanceBuffer{0};     // offsets in video memory, created on first use
+    };
+    // A building, drawn from the top left tile of its footprint
+    struct Building {
+        ModelType type;
+        int objectId;      // Code in the objects layer
+        Object *model;     // Owned by one of the shared pointers below
+        double targetSize; // 0 keeps the size of the model
+        int footprintWidth, footprintHeight;
+        double centerX, centerZ; // From the top left tile to where the model stands
+        double scale{1.0};       // Baked into the matrices of its placements
+    };
+    // A building or fence of the objects layer, resolved when the map loads
+    struct Placement {
+        ModelType model;
+        std::array<GLfloat, 16> matrix; // Model to world, column major for glMultMatrixf
+        int footprintWidth, footprintHeight; // Tiles
+    };
+    // CHUNK_SIZE by CHUNK_SIZE tiles of the map. Only the chunks in view are drawn.
+    struct Chunk {
+        std::size_t firstRow, firstColumn;
+        BoundingBox bounds;  // Of the terrain and of everything placed in the chunk
+        TerrainMesh terrain; // Baked the first time the chunk comes into view
+        std::vector<PropInstances> props; // In the order of Map::props
+        std::vector<Placement> objects; // Whose top left tile is in the chunk
+    };
+
+    // Splits the map into chunks and sorts the objects into the chunk of their top left tile.
+    // Called whenever the terrain or the objects change.
+    void buildChunks();
+    // Frees the buffers of every chunk
+    void releaseChunks();
+    // Finds the building or fence a code of the objects layer stands for, placed on tile (i, j).
+    // Returns false for codes that draw nothing.
+    bool resolvePlacement(int objectId, std::size_t i, std::size_t j, Placement &placement) const;
+    // Rescales the placements of the buildings whose model streamed in or changed size
+    void updateBuildingScales();
+    void renderProps();
+    // Reads a layer file. what names the layer in the error message.
+    static bool parseLayer(const std::string &path, const char *what, Layer &layer);
+    // Parses the layer again in the background whenever its file changes
+    void watchLayer(const std::string &path, const char *what, Layer &layer);
+
     void renderTerrain();
     void renderObjects();
     void renderMapObject(Object &object, double targetSize, double x, double y, double z,
-                         int footprintWidth, int footprintHeight,
-                         std::vector<std::vector<std::string>> &objects_copy, int i, int j);
-    void renderFence(ModelType fenceType, double x, double y, double z);
+                         int footprintWidth, int footprintHeight);
+    // Draws a fence at the origin, turned by its placement
+    static void renderFence(ModelType fenceType);
+    // Stands in for a model covering the footprint until it has streamed in
+    static void renderPlaceholder(int footprintWidth, int footprintHeight);
 
     std::vector<std::vector<std::string>> terrain;
     std::vector<std::vector<std::string>> objects;
     std::vector<std::vector<std::string>> events;
-    Object house;
-    Object tree;
-    Object flower;
-    Object grass;
-    Object woodenSign;
-    Object mailbox;
-    Object pokemonCenter;
-    Object pokeMart;
-    Object pokemonResearchLab;
+    std::vector<Prop> props;
+    std::vector<Building> buildings;
+    std::vector<Chunk> chunks; // Row by row
+    std::size_t chunkColumns{0};
+    std::vector<Chunk *> visibleChunks; // Found by the last render
+    std::string mapName;
+    std::vector<FileWatcher::WatchId> layerWatches;
+    std::size_t revision{0};
+    std::shared_ptr<Object> house;
+    std::shared_ptr<Object> tree;
+    std::shared_ptr<Object> flower;
+    std::shared_ptr<Object> grass;
+    std::shared_ptr<Object> woodenSign;
+    std::shared_ptr<Object> mailbox;
+    std::shared_ptr<Object> pokemonCenter;
+    std::shared_ptr<Object> pokeMart;
+    std::shared_ptr<Object> pokemonResearchLab;
 };
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Read-only view of a whole file mapped into memory. The mapping lives as long as the object.
+class MappedFile {
+  public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    bool open(const std::string &path);
+    void close();
+
+    bool isOpen() const {
+        return mapped;
+    }
+    const char *data() const {
+        return contents;
+    }
+    std::size_t size() const {
+        return length;
+    }
+    std::string_view view() const {
+        return {contents, length};
+    }
+
+  private:
+    const char *contents{nullptr};
+    std::size_t length{0};
+    bool mapped{false};
+#ifdef _WIN32
+    void *fileHandle{nullptr};
+    void *mappingHandle{nullptr};
+#endif
+};
@@ -1,4 +1,6 @@
 #include "Menu.h"
+#include "GLState.h"
+#include "RenderQueue.h"
 #include "freeglut.h"
 #include <numbers>
 
@@ -80,19 +82,25 @@ void Menu::render() {
     if (!visible)
         return;
 
+    RenderQueue::getInstance().submitCustom(
+        RenderQueue::Pass::Overlay, RenderQueue::Shader::FixedFunction,
+        [](const void *menu, std::uintptr_t) { static_cast<const Menu *>(menu)->draw(); }, this);
+}
+
+void Menu::draw() const {
     int windowWidth = glutGet(GLUT_WINDOW_WIDTH);
     int windowHeight = glutGet(GLUT_WINDOW_HEIGHT);
 
-    glDisable(GL_DEPTH_TEST);
+    GLState::disable(GL_DEPTH_TEST);
     // Switch to orthographic projection for 2D overlay
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
-    glLoadIdentity();
+    GLState::matrixMode(GL_PROJECTION);
+    GLState::pushMatrix();
+    GLState::loadIdentity();
     gluOrtho2D(0, windowWidth, 0, windowHeight);
 
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glLoadIdentity();
+    GLState::matrixMode(GL_MODELVIEW);
+    GLState::pushMatrix();
+    GLState::loadIdentity();
 
     // Coordinates and dimensions for the menu rectangles
     // Calculate menu position and button positions
@@ -125,13 +133,13 @@ void Menu::render() {
     }
 
     // Restore previous projection and modelview matrices
-    glPopMatrix();
-    glMatrixMode(GL_PROJECTION);
-    glPopMatrix();
-    glMatrixMode(GL_MODELVIEW);
+    GLState::popMatrix();
+    GLState::matrixMode(GL_PROJECTION);
+    GLState::popMatrix();
+    GLState::matrixMode(GL_MODELVIEW);
 
     // Re-enable depth testing after 2D overlay
-    glEnable(GL_DEPTH_TEST);
+    GLState::enable(GL_DEPTH_TEST);
 }
 
 void Menu::toggleVisibility() {
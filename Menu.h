@@ -6,6 +6,7 @@
 
 class Menu {
   public:
+    // Submits the menu to the render queue, to be drawn over the scene
     void render();
     void toggleVisibility();
     bool isVisible() const;
@@ -13,6 +14,8 @@ class Menu {
     void triggerSelection();
 
   private:
+    void draw() const;
+
     // State
     bool visible{false};
     int selectedEntry{0};
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct Vertex {
+    double x, y, z;
+};
+
+struct TextureCoord {
+    double u, v;
+};
+
+struct Normal {
+    double nx, ny, nz;
+};
+
+// A single triangle corner: 0-based indices, -1 when the face doesn't reference that attribute
+struct VertexIndex {
+    int vertex, texCoord, normal;
+
+    bool operator==(const VertexIndex &) const = default;
+};
+
+struct Group {
+    std::string name;
+    std::string material;
+    std::vector<VertexIndex> indices; // Three consecutive corners per triangle
+};
+
+struct BoundingBox {
+    Vertex min, max;
+};
+
+// Geometry exactly as it is described in an OBJ file
+struct Mesh {
+    std::vector<Vertex> vertices;
+    std::vector<TextureCoord> textureCoords;
+    std::vector<Normal> normals;
+    std::unordered_map<std::string, Group> groups;
+    std::vector<std::string> materialLibraries; // The material library files
+    BoundingBox boundingBox{};
+};
+
+// Interleaved vertex in the GL_T2F_N3F_V3F layout of glInterleavedArrays
+struct PackedVertex {
+    float u, v;
+    float nx, ny, nz;
+    float x, y, z;
+
+    bool operator==(const PackedVertex &) const = default;
+};
+
+// How vertices are kept in memory and in the mesh cache: 20 bytes instead of 32. The normal is
+// octahedral encoded in two snorm16 values and the texture coordinates are half floats. See
+// VertexCodec for the conversions.
+struct CompactVertex {
+    float x, y, z;
+    std::int16_t normal[2];
+    std::uint16_t texCoord[2];
+
+    bool operator==(const CompactVertex &) const = default;
+};
+
+// Triangle list indices into a section's vertex range, 16-bit whenever the range is small enough
+struct IndexBuffer {
+    std::vector<std::uint16_t> shortIndices;
+    std::vector<std::uint32_t> longIndices; // Only used when the range is too large for 16 bits
+
+    void assign(const std::vector<std::uint32_t> &indices, std::uint32_t vertexCount) {
+        shortIndices.clear();
+        longIndices.clear();
+        if (vertexCount <= 65536) {
+            shortIndices.assign(indices.begin(), indices.end());
+        } else {
+            longIndices = indices;
+        }
+    }
+    bool isShort() const {
+        return longIndices.empty();
+    }
+    std::size_t size() const {
+        return isShort() ? shortIndices.size() : longIndices.size();
+    }
+    std::uint32_t operator[](std::size_t i) const {
+        return isShort() ? shortIndices[i] : longIndices[i];
+    }
+    // Memory held in RAM
+    std::size_t getBytes() const {
+        return shortIndices.capacity() * sizeof(std::uint16_t) +
+               longIndices.capacity() * sizeof(std::uint32_t);
+    }
+    bool operator==(const IndexBuffer &) const = default;
+};
+
+// A group ready for glDrawElements. It owns the range [firstVertex, firstVertex + vertexCount) of
+// IndexedMesh::vertices and its indices are relative to firstVertex, so they fit in 16 bits unless
+// the group has more than 65536 unique corners.
+struct Section {
+    std::string name;
+    std::string material;
+    std::uint32_t firstVertex{0};
+    std::uint32_t vertexCount{0};
+    IndexBuffer indices;
+    // Simplified levels of detail drawn from the same vertices, coarsest last
+    std::vector<IndexBuffer> levels;
+};
+
+// A Mesh after identical corners have been welded together, as the renderer consumes it
+struct IndexedMesh {
+    std::vector<CompactVertex> vertices;
+    std::vector<Section> sections; // Sorted by name
+    std::vector<std::string> materialLibraries;
+    BoundingBox boundingBox{};
+    bool optimizedOrder{false}; // Triangles reordered by MeshBuilder::optimizeOrder
+};
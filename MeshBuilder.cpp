@@ -0,0 +1,155 @@
+#include "MeshBuilder.h"
+#include "MeshSimplifier.h"
+#include "Trace.h"
+#include "VertexCodec.h"
+#include <algorithm>
+#include <unordered_map>
+
+namespace {
+
+// Fraction of the original triangles kept by each level of detail
+const std::vector<double> LEVEL_TRIANGLE_RATIOS{0.5, 0.25, 0.125};
+// Smaller meshes are cheap enough to always draw at full detail
+constexpr std::size_t MIN_LEVEL_TRIANGLES{500};
+
+struct VertexIndexHash {
+    std::size_t operator()(const VertexIndex &corner) const noexcept {
+        std::uint64_t hash = static_cast<std::uint32_t>(corner.vertex);
+        hash = hash * 0x9E3779B97F4A7C15ull ^ static_cast<std::uint32_t>(corner.texCoord);
+        hash = hash * 0x9E3779B97F4A7C15ull ^ static_cast<std::uint32_t>(corner.normal);
+        return static_cast<std::size_t>(hash ^ (hash >> 32));
+    }
+};
+
+// Missing attributes are zero. Lighting is off, so a zero normal is never used.
+PackedVertex packCorner(const Mesh &mesh, const VertexIndex &corner) {
+    PackedVertex packed{};
+    if (corner.texCoord >= 0) {
+        const auto &tc = mesh.textureCoords[corner.texCoord];
+        packed.u = static_cast<float>(tc.u);
+        packed.v = static_cast<float>(tc.v);
+    }
+    if (corner.normal >= 0) {
+        const auto &n = mesh.normals[corner.normal];
+        packed.nx = static_cast<float>(n.nx);
+        packed.ny = static_cast<float>(n.ny);
+        packed.nz = static_cast<float>(n.nz);
+    }
+    const auto &v = mesh.vertices[corner.vertex];
+    packed.x = static_cast<float>(v.x);
+    packed.y = static_cast<float>(v.y);
+    packed.z = static_cast<float>(v.z);
+    return packed;
+}
+
+} // namespace
+
+void MeshBuilder::buildIndexed(const Mesh &mesh, IndexedMesh &indexed) {
+    TRACE_SCOPE("Weld vertices");
+    indexed = IndexedMesh{};
+    indexed.materialLibraries = mesh.materialLibraries;
+    indexed.boundingBox = mesh.boundingBox;
+
+    std::vector<const std::pair<const std::string, Group> *> groups;
+    for (const auto &group : mesh.groups) {
+        groups.push_back(&group);
+    }
+    std::sort(groups.begin(), groups.end(), [](auto *a, auto *b) { return a->first < b->first; });
+
+    std::unordered_map<VertexIndex, std::uint32_t, VertexIndexHash> welded;
+    std::vector<std::uint32_t> indices;
+    for (const auto *entry : groups) {
+        const auto &[name, group] = *entry;
+        Section section;
+        section.name = name;
+        section.material = group.material;
+        section.firstVertex = static_cast<std::uint32_t>(indexed.vertices.size());
+
+        welded.clear();
+        welded.reserve(group.indices.size());
+        indices.clear();
+        indices.reserve(group.indices.size());
+        for (const auto &corner : group.indices) {
+            auto [found, inserted] =
+                welded.try_emplace(corner, static_cast<std::uint32_t>(welded.size()));
+            if (inserted) {
+                indexed.vertices.push_back(VertexCodec::encode(packCorner(mesh, corner)));
+            }
+            indices.push_back(found->second);
+        }
+
+        section.vertexCount = static_cast<std::uint32_t>(welded.size());
+        section.indices.assign(indices, section.vertexCount);
+        indexed.sections.push_back(std::move(section));
+    }
+}
+
+void MeshBuilder::buildLevels(IndexedMesh &indexed) {
+    TRACE_SCOPE("Build levels of detail");
+    std::size_t triangles = 0;
+    for (const auto &section : indexed.sections) {
+        triangles += section.indices.size() / 3;
+    }
+    if (triangles < MIN_LEVEL_TRIANGLES) {
+        return;
+    }
+
+    std::vector<PackedVertex> vertices;
+    std::vector<std::uint32_t> indices;
+    for (auto &section : indexed.sections) {
+        section.levels.clear();
+        vertices.resize(section.vertexCount);
+        for (std::uint32_t i = 0; i < section.vertexCount; ++i) {
+            vertices[i] = VertexCodec::decode(indexed.vertices[section.firstVertex + i]);
+        }
+        indices.resize(section.indices.size());
+        for (std::size_t i = 0; i < indices.size(); ++i) {
+            indices[i] = section.indices[i];
+        }
+
+        auto levels = MeshSimplifier::simplify(vertices, indices, LEVEL_TRIANGLE_RATIOS);
+        for (const auto &level : levels) {
+            section.levels.emplace_back().assign(level, section.vertexCount);
+        }
+    }
+}
+
+void MeshBuilder::optimizeOrder(IndexedMesh &indexed) {
+    TRACE_SCOPE("Optimize triangle order");
+    std::vector<PackedVertex> vertices;
+    std::vector<std::uint32_t> indices;
+    for (auto &section : indexed.sections) {
+        vertices.resize(section.vertexCount);
+        for (std::uint32_t i = 0; i < section.vertexCount; ++i) {
+            vertices[i] = VertexCodec::decode(indexed.vertices[section.firstVertex + i]);
+        }
+
+        auto optimize = [&](IndexBuffer &buffer) {
+            indices.resize(buffer.size());
+            for (std::size_t i = 0; i < indices.size(); ++i) {
+                indices[i] = buffer[i];
+            }
+            MeshOptimizer::optimizeVertexCache(indices, section.vertexCount);
+            MeshOptimizer::optimizeOverdraw(indices, vertices);
+            buffer.assign(indices, section.vertexCount);
+        };
+        optimize(section.indices);
+        for (auto &level : section.levels) {
+            optimize(level);
+        }
+    }
+    indexed.optimizedOrder = true;
+}
+
+MeshOptimizer::CacheStats MeshBuilder::analyzeCache(const IndexedMesh &indexed) {
+    MeshOptimizer::CacheStats stats;
+    std::vector<std::uint32_t> indices;
+    for (const auto &section : indexed.sections) {
+        indices.resize(section.indices.size());
+        for (std::size_t i = 0; i < indices.size(); ++i) {
+            indices[i] = section.indices[i];
+        }
+        stats += MeshOptimizer::analyzeCache(indices, section.vertexCount);
+    }
+    return stats;
+}
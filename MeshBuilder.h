@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Mesh.h"
+#include "MeshOptimizer.h"
+
+// Turns parsed OBJ geometry into the form the renderer draws
+namespace MeshBuilder {
+// Welds the corners of each group that share the same (v, vt, vn) triple into a single compact
+// vertex and builds the group's index buffer
+void buildIndexed(const Mesh &mesh, IndexedMesh &indexed);
+// Adds simplified levels of detail to every section of meshes with enough triangles to benefit
+void buildLevels(IndexedMesh &indexed);
+// Reorders the triangles of every section and level for the vertex cache and then for overdraw
+void optimizeOrder(IndexedMesh &indexed);
+// Vertex cache efficiency of the full detail index buffers of all sections together
+MeshOptimizer::CacheStats analyzeCache(const IndexedMesh &indexed);
+}
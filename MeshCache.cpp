@@ -0,0 +1,254 @@
+#include "MeshCache.h"
+#include "Trace.h"
+#include "VirtualFileSystem.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+
+namespace {
+
+constexpr char MAGIC[4]{'M', 'B', 'I', 'N'};
+// Sanity limit for the level count read from a file
+constexpr std::uint32_t MAX_LEVELS{16};
+// Header::flags
+constexpr std::uint32_t FLAG_OPTIMIZED_ORDER{1};
+
+struct Header {
+    char magic[4];
+    std::uint32_t version;
+    std::uint64_t sourceSize;
+    std::int64_t sourceModified;
+    std::uint32_t vertexCount;
+    std::uint32_t sectionCount;
+    std::uint32_t materialLibraryCount;
+    std::uint32_t flags;
+    BoundingBox boundingBox;
+};
+
+// Followed by the section's name and material, then its index buffer and one per level of detail,
+// each as a count and the indices
+struct SectionRecord {
+    std::uint32_t firstVertex;
+    std::uint32_t vertexCount;
+    std::uint32_t indexSize; // 2 or 4 bytes
+    std::uint32_t levelCount;
+    std::uint32_t nameLength;
+    std::uint32_t materialLength;
+};
+
+static_assert(std::is_trivially_copyable_v<CompactVertex> && sizeof(CompactVertex) == 20);
+
+// Bounds-checked reads from the mapped file
+class Reader {
+  public:
+    explicit Reader(std::string_view data) : data{data} {}
+
+    template <typename T> bool read(T *out, std::size_t count = 1) {
+        const std::size_t bytes = sizeof(T) * count;
+        if (data.size() - offset < bytes) {
+            return false;
+        }
+        std::memcpy(out, data.data() + offset, bytes);
+        offset += bytes;
+        return true;
+    }
+
+    // Checks the count against what is left before allocating, so a corrupt count can't ask for
+    // gigabytes
+    template <typename T> bool readArray(std::vector<T> &out, std::size_t count) {
+        if ((data.size() - offset) / sizeof(T) < count) {
+            return false;
+        }
+        out.resize(count);
+        return read(out.data(), count);
+    }
+
+    bool readString(std::string &out, std::size_t length) {
+        if (data.size() - offset < length) {
+            return false;
+        }
+        out.assign(data.data() + offset, length);
+        offset += length;
+        return true;
+    }
+
+  private:
+    std::string_view data;
+    std::size_t offset{0};
+};
+
+template <typename T> void write(std::ofstream &file, const T *data, std::size_t count = 1) {
+    file.write(reinterpret_cast<const char *>(data), sizeof(T) * count);
+}
+
+// Whether every index points into the section. A plain loop over the largest index, as this runs
+// over every index of every level and has to stay cheap in unoptimized builds too.
+template <typename T> bool allBelow(const std::vector<T> &indices, std::uint32_t limit) {
+    const T *index = indices.data();
+    const T *end = index + indices.size();
+    std::uint32_t largest = 0;
+    for (; index != end; ++index) {
+        largest = *index > largest ? *index : largest;
+    }
+    return indices.empty() || largest < limit;
+}
+
+bool readIndexBuffer(Reader &reader, const SectionRecord &record, IndexBuffer &buffer) {
+    std::uint32_t count;
+    // Triangle lists only
+    if (!reader.read(&count) || count % 3 != 0) {
+        return false;
+    }
+    if (record.indexSize == sizeof(std::uint16_t)) {
+        return reader.readArray(buffer.shortIndices, count) &&
+               allBelow(buffer.shortIndices, record.vertexCount);
+    }
+    if (record.indexSize == sizeof(std::uint32_t)) {
+        return reader.readArray(buffer.longIndices, count) &&
+               allBelow(buffer.longIndices, record.vertexCount);
+    }
+    return false;
+}
+
+void writeIndexBuffer(std::ofstream &file, const IndexBuffer &buffer) {
+    const auto count = static_cast<std::uint32_t>(buffer.size());
+    write(file, &count);
+    if (buffer.isShort()) {
+        write(file, buffer.shortIndices.data(), buffer.shortIndices.size());
+    } else {
+        write(file, buffer.longIndices.data(), buffer.longIndices.size());
+    }
+}
+
+} // namespace
+
+std::string MeshCache::cachePath(const std::string &objPath) {
+    return std::filesystem::path(objPath).replace_extension(".meshbin").string();
+}
+
+bool MeshCache::load(const std::string &objPath, IndexedMesh &mesh) {
+    TRACE_SCOPE("Load mesh cache", objPath);
+    auto &fileSystem = VirtualFileSystem::getInstance();
+    FileStamp source;
+    AssetFile file;
+    if (!fileSystem.stat(objPath, source) || !fileSystem.open(cachePath(objPath), file)) {
+        return false;
+    }
+
+    Reader reader(file.view());
+    Header header;
+    if (!reader.read(&header) || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header.version != VERSION || header.sourceSize != source.size ||
+        header.sourceModified != source.modified) {
+        return false;
+    }
+
+    IndexedMesh loaded;
+    if (!reader.readArray(loaded.vertices, header.vertexCount)) {
+        return false;
+    }
+
+    for (std::uint32_t i = 0; i < header.sectionCount; ++i) {
+        SectionRecord record;
+        Section section;
+        if (!reader.read(&record) || record.firstVertex > loaded.vertices.size() ||
+            record.vertexCount > loaded.vertices.size() - record.firstVertex ||
+            !reader.readString(section.name, record.nameLength) ||
+            !reader.readString(section.material, record.materialLength)) {
+            return false;
+        }
+        section.firstVertex = record.firstVertex;
+        section.vertexCount = record.vertexCount;
+
+        if (record.levelCount > MAX_LEVELS || !readIndexBuffer(reader, record, section.indices)) {
+            return false;
+        }
+        section.levels.resize(record.levelCount);
+        for (auto &level : section.levels) {
+            if (!readIndexBuffer(reader, record, level)) {
+                return false;
+            }
+        }
+        loaded.sections.push_back(std::move(section));
+    }
+
+    for (std::uint32_t i = 0; i < header.materialLibraryCount; ++i) {
+        std::uint32_t length;
+        std::string materialLibrary;
+        if (!reader.read(&length) || !reader.readString(materialLibrary, length)) {
+            return false;
+        }
+        loaded.materialLibraries.push_back(std::move(materialLibrary));
+    }
+
+    loaded.boundingBox = header.boundingBox;
+    loaded.optimizedOrder = (header.flags & FLAG_OPTIMIZED_ORDER) != 0;
+    mesh = std::move(loaded);
+    return true;
+}
+
+bool MeshCache::save(const std::string &objPath, const IndexedMesh &mesh) {
+    TRACE_SCOPE("Save mesh cache", objPath);
+    FileStamp source;
+    if (!VirtualFileSystem::getInstance().stat(objPath, source)) {
+        return false;
+    }
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.sourceSize = source.size;
+    header.sourceModified = source.modified;
+    header.vertexCount = static_cast<std::uint32_t>(mesh.vertices.size());
+    header.sectionCount = static_cast<std::uint32_t>(mesh.sections.size());
+    header.materialLibraryCount = static_cast<std::uint32_t>(mesh.materialLibraries.size());
+    header.flags = mesh.optimizedOrder ? FLAG_OPTIMIZED_ORDER : 0;
+    header.boundingBox = mesh.boundingBox;
+
+    // Write to a temporary file first so a half-written cache is never picked up
+    const std::string path = cachePath(objPath);
+    const std::string temporaryPath = path + ".tmp";
+    bool written = false;
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+
+        write(file, &header);
+        write(file, mesh.vertices.data(), mesh.vertices.size());
+        for (const auto &section : mesh.sections) {
+            SectionRecord record{section.firstVertex,
+                                 section.vertexCount,
+                                 section.indices.isShort() ? 2u : 4u,
+                                 static_cast<std::uint32_t>(section.levels.size()),
+                                 static_cast<std::uint32_t>(section.name.size()),
+                                 static_cast<std::uint32_t>(section.material.size())};
+            write(file, &record);
+            write(file, section.name.data(), section.name.size());
+            write(file, section.material.data(), section.material.size());
+            writeIndexBuffer(file, section.indices);
+            for (const auto &level : section.levels) {
+                writeIndexBuffer(file, level);
+            }
+        }
+        for (const auto &materialLibrary : mesh.materialLibraries) {
+            auto length = static_cast<std::uint32_t>(materialLibrary.size());
+            write(file, &length);
+            write(file, materialLibrary.data(), materialLibrary.size());
+        }
+
+        written = static_cast<bool>(file);
+    }
+
+    std::error_code error;
+    if (written) {
+        std::filesystem::rename(temporaryPath, path, error);
+    }
+    if (!written || error) {
+        std::filesystem::remove(temporaryPath, error);
+        std::cerr << "Failed to write mesh cache: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Mesh.h"
+#include <cstdint>
+#include <string>
+
+// Binary copy of a welded OBJ (.meshbin) written next to the source file. The cache records the
+// size and modification time of the OBJ it was built from and is ignored once they change.
+namespace MeshCache {
+// Bump whenever the layout of the file or of Mesh changes
+constexpr std::uint32_t VERSION{5};
+
+std::string cachePath(const std::string &objPath);
+// Fills mesh from the cache if it exists and is still fresh
+bool load(const std::string &objPath, IndexedMesh &mesh);
+bool save(const std::string &objPath, const IndexedMesh &mesh);
+}
@@ -0,0 +1,335 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace {
+
+// Scoring constants from Forsyth's article. The scoring cache is an LRU larger than the FIFO the
+// result is measured with, so vertices that are about to fall out still pull their triangles in.
+constexpr std::size_t SCORE_CACHE_SIZE{32};
+constexpr float CACHE_DECAY_POWER{1.5f};
+constexpr float LAST_TRIANGLE_SCORE{0.75f};
+constexpr float VALENCE_BOOST_SCALE{2.0f};
+constexpr float VALENCE_BOOST_POWER{0.5f};
+
+constexpr std::uint32_t NO_TRIANGLE{std::numeric_limits<std::uint32_t>::max()};
+
+std::atomic<bool> enabled{true};
+
+float vertexScore(int cachePosition, std::uint32_t remainingTriangles) {
+    if (remainingTriangles == 0) {
+        // Nothing left to draw with it
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        if (cachePosition < 3) {
+            // Used by the last triangle. Scored lower than the next few on purpose, so that the
+            // next triangle doesn't just reuse the same edge and strips are avoided.
+            score = LAST_TRIANGLE_SCORE;
+        } else {
+            const float scale = 1.0f / (SCORE_CACHE_SIZE - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scale, CACHE_DECAY_POWER);
+        }
+    }
+    // Finish off vertices with few triangles left so they can leave the cache
+    score += VALENCE_BOOST_SCALE *
+             std::pow(static_cast<float>(remainingTriangles), -VALENCE_BOOST_POWER);
+    return score;
+}
+
+// FIFO post-transform cache simulation
+class FifoCache {
+  public:
+    explicit FifoCache(std::size_t vertexCount) : insertedAt(vertexCount, NEVER) {}
+
+    // Returns true if the vertex had to be transformed
+    bool access(std::uint32_t vertex) {
+        if (insertedAt[vertex] != NEVER &&
+            clock - insertedAt[vertex] < MeshOptimizer::CacheStats::CACHE_SIZE) {
+            return false;
+        }
+        insertedAt[vertex] = clock++;
+        return true;
+    }
+    void reset() {
+        clock += MeshOptimizer::CacheStats::CACHE_SIZE;
+    }
+
+  private:
+    static constexpr std::size_t NEVER{std::numeric_limits<std::size_t>::max()};
+    std::vector<std::size_t> insertedAt;
+    std::size_t clock{0};
+};
+
+std::size_t triangleMisses(FifoCache &cache, const std::uint32_t *triangle) {
+    return cache.access(triangle[0]) + cache.access(triangle[1]) + cache.access(triangle[2]);
+}
+
+// Draws the clusters (given by their first triangle, plus the end) that face away from the middle
+// of the mesh first: they are on its outside and the most likely to hide the others
+std::vector<std::uint32_t> sortClusters(const std::vector<std::uint32_t> &indices,
+                                        const std::vector<PackedVertex> &vertices,
+                                        const std::vector<std::size_t> &clusters) {
+    const std::size_t clusterCount = clusters.size() - 1;
+
+    double centerX = 0.0, centerY = 0.0, centerZ = 0.0;
+    for (const auto &vertex : vertices) {
+        centerX += vertex.x;
+        centerY += vertex.y;
+        centerZ += vertex.z;
+    }
+    centerX /= vertices.size();
+    centerY /= vertices.size();
+    centerZ /= vertices.size();
+
+    std::vector<double> facing(clusterCount, 0.0);
+    for (std::size_t c = 0; c < clusterCount; ++c) {
+        double x = 0.0, y = 0.0, z = 0.0, nx = 0.0, ny = 0.0, nz = 0.0, area = 0.0;
+        for (std::size_t t = clusters[c]; t < clusters[c + 1]; ++t) {
+            const auto &a = vertices[indices[t * 3]];
+            const auto &b = vertices[indices[t * 3 + 1]];
+            const auto &d = vertices[indices[t * 3 + 2]];
+            const double ux = b.x - a.x, uy = b.y - a.y, uz = b.z - a.z;
+            const double vx = d.x - a.x, vy = d.y - a.y, vz = d.z - a.z;
+            const double cx = uy * vz - uz * vy, cy = uz * vx - ux * vz, cz = ux * vy - uy * vx;
+            const double triangleArea = std::sqrt(cx * cx + cy * cy + cz * cz);
+            // Area weighted centroid and normal
+            x += (a.x + b.x + d.x) / 3.0 * triangleArea;
+            y += (a.y + b.y + d.y) / 3.0 * triangleArea;
+            z += (a.z + b.z + d.z) / 3.0 * triangleArea;
+            nx += cx;
+            ny += cy;
+            nz += cz;
+            area += triangleArea;
+        }
+        const double normalLength = std::sqrt(nx * nx + ny * ny + nz * nz);
+        if (area > 0.0 && normalLength > 0.0) {
+            facing[c] = ((x / area - centerX) * nx + (y / area - centerY) * ny +
+                         (z / area - centerZ) * nz) /
+                        normalLength;
+        }
+    }
+
+    std::vector<std::size_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&](std::size_t a, std::size_t b) { return facing[a] > facing[b]; });
+
+    std::vector<std::uint32_t> sorted;
+    sorted.reserve(indices.size());
+    for (const std::size_t c : order) {
+        sorted.insert(sorted.end(), indices.begin() + clusters[c] * 3,
+                      indices.begin() + clusters[c + 1] * 3);
+    }
+    return sorted;
+}
+
+} // namespace
+
+MeshOptimizer::CacheStats MeshOptimizer::analyzeCache(const std::vector<std::uint32_t> &indices,
+                                                      std::uint32_t vertexCount) {
+    CacheStats stats;
+    stats.triangles = indices.size() / 3;
+    FifoCache cache(vertexCount);
+    std::vector<bool> used(vertexCount, false);
+    for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+        stats.transformed += triangleMisses(cache, &indices[i]);
+    }
+    for (const std::uint32_t index : indices) {
+        if (!used[index]) {
+            used[index] = true;
+            ++stats.vertices;
+        }
+    }
+    return stats;
+}
+
+void MeshOptimizer::optimizeVertexCache(std::vector<std::uint32_t> &indices,
+                                        std::uint32_t vertexCount) {
+    const std::size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2) {
+        return;
+    }
+
+    // Triangles around each vertex. Only the first remaining[v] entries of a vertex are still to
+    // be drawn; emitted triangles are swapped out of the way.
+    std::vector<std::uint32_t> remaining(vertexCount, 0);
+    for (std::size_t i = 0; i < triangleCount * 3; ++i) {
+        ++remaining[indices[i]];
+    }
+    std::vector<std::uint32_t> offsets(vertexCount + 1, 0);
+    std::partial_sum(remaining.begin(), remaining.end(), offsets.begin() + 1);
+    std::vector<std::uint32_t> adjacency(triangleCount * 3);
+    {
+        std::vector<std::uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (std::size_t i = 0; i < triangleCount * 3; ++i) {
+            adjacency[fill[indices[i]]++] = static_cast<std::uint32_t>(i / 3);
+        }
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (std::uint32_t v = 0; v < vertexCount; ++v) {
+        vertexScores[v] = vertexScore(-1, remaining[v]);
+    }
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<bool> emitted(triangleCount, false);
+    for (std::size_t t = 0; t < triangleCount; ++t) {
+        triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] +
+                            vertexScores[indices[t * 3 + 2]];
+    }
+
+    std::vector<std::uint32_t> output;
+    output.reserve(triangleCount * 3);
+    std::array<std::uint32_t, SCORE_CACHE_SIZE + 3> cache, nextCache;
+    std::size_t cacheCount = 0;
+    std::uint32_t best = static_cast<std::uint32_t>(
+        std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin());
+    std::size_t cursor = 0;
+
+    while (true) {
+        if (best == NO_TRIANGLE) {
+            // Dead end: nothing in the cache has triangles left, so carry on in input order
+            while (cursor < triangleCount && emitted[cursor]) {
+                ++cursor;
+            }
+            if (cursor == triangleCount) {
+                break;
+            }
+            best = static_cast<std::uint32_t>(cursor);
+        }
+
+        emitted[best] = true;
+        const std::uint32_t *triangle = &indices[best * 3];
+        output.insert(output.end(), triangle, triangle + 3);
+
+        // The triangle's vertices move to the front of the cache, the rest shift back
+        std::size_t nextCount = 0;
+        for (int k = 0; k < 3; ++k) {
+            const std::uint32_t v = triangle[k];
+            // Once per corner, since degenerate triangles are listed once per corner too
+            auto first = adjacency.begin() + offsets[v];
+            auto last = first + remaining[v];
+            *std::find(first, last, best) = *(last - 1);
+            --remaining[v];
+
+            if (std::find(nextCache.begin(), nextCache.begin() + nextCount, v) ==
+                nextCache.begin() + nextCount) {
+                nextCache[nextCount++] = v;
+            }
+        }
+        for (std::size_t i = 0; i < cacheCount; ++i) {
+            const std::uint32_t v = cache[i];
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+                nextCache[nextCount++] = v;
+            }
+        }
+
+        // Rescore the vertices that moved, including those pushed out of the cache
+        for (std::size_t i = 0; i < nextCount; ++i) {
+            const std::uint32_t v = nextCache[i];
+            cachePosition[v] = i < SCORE_CACHE_SIZE ? static_cast<int>(i) : -1;
+            vertexScores[v] = vertexScore(cachePosition[v], remaining[v]);
+        }
+
+        // Then the triangles around them, taking the best as the next one
+        best = NO_TRIANGLE;
+        float bestScore = -1.0f;
+        for (std::size_t i = 0; i < nextCount; ++i) {
+            const std::uint32_t v = nextCache[i];
+            for (std::uint32_t j = offsets[v]; j < offsets[v] + remaining[v]; ++j) {
+                const std::uint32_t t = adjacency[j];
+                const float score = vertexScores[indices[t * 3]] +
+                                    vertexScores[indices[t * 3 + 1]] +
+                                    vertexScores[indices[t * 3 + 2]];
+                triangleScores[t] = score;
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = t;
+                }
+            }
+        }
+
+        cacheCount = std::min(nextCount, SCORE_CACHE_SIZE);
+        std::copy(nextCache.begin(), nextCache.begin() + cacheCount, cache.begin());
+    }
+
+    indices = std::move(output);
+}
+
+void MeshOptimizer::optimizeOverdraw(std::vector<std::uint32_t> &indices,
+                                     const std::vector<PackedVertex> &vertices, double threshold) {
+    const std::size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2) {
+        return;
+    }
+
+    // Hard boundaries: triangles that miss the cache with all three vertices start a new cluster
+    // without costing anything
+    std::vector<std::size_t> hardClusters;
+    {
+        FifoCache cache(vertices.size());
+        for (std::size_t t = 0; t < triangleCount; ++t) {
+            if (triangleMisses(cache, &indices[t * 3]) == 3) {
+                hardClusters.push_back(t);
+            }
+        }
+    }
+    hardClusters.push_back(triangleCount);
+
+    // Soft boundaries: split each cluster again as soon as the piece so far, drawn with a cold
+    // cache, is within threshold of the ACMR of the whole cluster
+    std::vector<std::size_t> softClusters;
+    FifoCache cache(vertices.size());
+    for (std::size_t c = 0; c + 1 < hardClusters.size(); ++c) {
+        const std::size_t first = hardClusters[c], last = hardClusters[c + 1];
+        cache.reset();
+        std::size_t misses = 0;
+        for (std::size_t t = first; t < last; ++t) {
+            misses += triangleMisses(cache, &indices[t * 3]);
+        }
+        const double clusterAcmr = static_cast<double>(misses) / (last - first);
+
+        cache.reset();
+        softClusters.push_back(first);
+        std::size_t start = first;
+        misses = 0;
+        for (std::size_t t = first; t < last; ++t) {
+            misses += triangleMisses(cache, &indices[t * 3]);
+            if (t + 1 < last &&
+                static_cast<double>(misses) / (t + 1 - start) <= clusterAcmr * threshold) {
+                softClusters.push_back(t + 1);
+                start = t + 1;
+                misses = 0;
+                cache.reset();
+            }
+        }
+    }
+    softClusters.push_back(triangleCount);
+
+    const auto vertexCount = static_cast<std::uint32_t>(vertices.size());
+    const double maxAcmr = analyzeCache(indices, vertexCount).getAcmr() * threshold;
+    // The last cluster of each hard cluster can come out worse than the rest, so fall back to
+    // fewer, larger clusters when the fine ones cost too much
+    for (const auto *clusters : {&softClusters, &hardClusters}) {
+        auto reordered = sortClusters(indices, vertices, *clusters);
+        if (analyzeCache(reordered, vertexCount).getAcmr() <= maxAcmr) {
+            indices = std::move(reordered);
+            return;
+        }
+    }
+}
+
+void MeshOptimizer::setEnabled(bool value) {
+    enabled = value;
+}
+
+bool MeshOptimizer::isEnabled() {
+    return enabled;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Mesh.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Reorders triangle lists so the GPU transforms fewer vertices and shades fewer hidden pixels. Only
+// the order of the triangles changes, never the vertices or what is drawn.
+namespace MeshOptimizer {
+// How well an index buffer uses the post-transform vertex cache, simulated as a FIFO of
+// CACHE_SIZE vertices like most hardware of the fixed function era
+struct CacheStats {
+    static constexpr std::size_t CACHE_SIZE{16};
+
+    std::size_t triangles{0};
+    std::size_t transformed{0}; // Cache misses
+    std::size_t vertices{0};    // Distinct vertices referenced
+
+    // Average cache miss ratio: transformed vertices per triangle, 0.5 at best and 3 at worst
+    double getAcmr() const {
+        return triangles == 0 ? 0.0 : static_cast<double>(transformed) / triangles;
+    }
+    // Average transform to vertex ratio: how many times each vertex is transformed, 1 at best
+    double getAtvr() const {
+        return vertices == 0 ? 0.0 : static_cast<double>(transformed) / vertices;
+    }
+    CacheStats &operator+=(const CacheStats &other) {
+        triangles += other.triangles;
+        transformed += other.transformed;
+        vertices += other.vertices;
+        return *this;
+    }
+};
+
+CacheStats analyzeCache(const std::vector<std::uint32_t> &indices, std::uint32_t vertexCount);
+
+// Reorders the triangles for post-transform cache reuse with Tom Forsyth's linear-speed greedy
+// algorithm ("Linear-Speed Vertex Cache Optimisation")
+void optimizeVertexCache(std::vector<std::uint32_t> &indices, std::uint32_t vertexCount);
+// Reorders the clusters of an index buffer that went through optimizeVertexCache so the ones
+// facing outwards, which are the most likely to hide the rest, are drawn first (Sander et al.,
+// "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"). Clusters are cut where the
+// cache starts over anyway, or where the ACMR stays within threshold of the original. The order is
+// left alone if the result would lose more than threshold of cache efficiency.
+void optimizeOverdraw(std::vector<std::uint32_t> &indices,
+                      const std::vector<PackedVertex> &vertices, double threshold = 1.05);
+
+// Whether meshes are reordered when they are built. On by default, can be turned off from the
+// command line to compare both orders.
+void setEnabled(bool enabled);
+bool isEnabled();
+}
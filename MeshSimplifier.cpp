@@ -0,0 +1,346 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+
+namespace {
+
+// Largest error a collapse may introduce, relative to the size of the mesh
+constexpr double MAX_ERROR_RATIO{0.05};
+// A level is only kept if it has at most this fraction of the previous level's triangles
+constexpr double MIN_REDUCTION{0.9};
+
+struct Position {
+    double x, y, z;
+};
+
+// Sum of squared distances to a set of planes, as a symmetric 4x4 matrix
+struct Quadric {
+    double a00{0}, a01{0}, a02{0}, a11{0}, a12{0}, a22{0};
+    double b0{0}, b1{0}, b2{0};
+    double c{0};
+
+    void addPlane(double nx, double ny, double nz, double d) {
+        a00 += nx * nx;
+        a01 += nx * ny;
+        a02 += nx * nz;
+        a11 += ny * ny;
+        a12 += ny * nz;
+        a22 += nz * nz;
+        b0 += nx * d;
+        b1 += ny * d;
+        b2 += nz * d;
+        c += d * d;
+    }
+
+    Quadric &operator+=(const Quadric &other) {
+        a00 += other.a00;
+        a01 += other.a01;
+        a02 += other.a02;
+        a11 += other.a11;
+        a12 += other.a12;
+        a22 += other.a22;
+        b0 += other.b0;
+        b1 += other.b1;
+        b2 += other.b2;
+        c += other.c;
+        return *this;
+    }
+
+    double error(const Position &p) const {
+        return a00 * p.x * p.x + 2 * a01 * p.x * p.y + 2 * a02 * p.x * p.z + a11 * p.y * p.y +
+               2 * a12 * p.y * p.z + a22 * p.z * p.z + 2 * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+    }
+};
+
+Position cross(const Position &a, const Position &b, const Position &c) {
+    const double ux = b.x - a.x, uy = b.y - a.y, uz = b.z - a.z;
+    const double vx = c.x - a.x, vy = c.y - a.y, vz = c.z - a.z;
+    return {uy * vz - uz * vy, uz * vx - ux * vz, ux * vy - uy * vx};
+}
+
+double dot(const Position &a, const Position &b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+struct PositionKey {
+    std::uint32_t x, y, z;
+    bool operator==(const PositionKey &) const = default;
+};
+
+struct PositionKeyHash {
+    std::size_t operator()(const PositionKey &key) const noexcept {
+        std::uint64_t hash = key.x;
+        hash = hash * 0x9E3779B97F4A7C15ull ^ key.y;
+        hash = hash * 0x9E3779B97F4A7C15ull ^ key.z;
+        return static_cast<std::size_t>(hash ^ (hash >> 32));
+    }
+};
+
+struct Collapse {
+    double cost;
+    std::uint32_t from, to;
+};
+
+class Simplifier {
+  public:
+    Simplifier(const std::vector<PackedVertex> &vertices, const std::vector<std::uint32_t> &indices)
+        : vertices{vertices} {
+        // Vertices that only differ in their attributes share a position; those are the wedges
+        // of that position
+        std::unordered_map<PositionKey, std::uint32_t, PositionKeyHash> positionIds;
+        positionOf.resize(vertices.size());
+        for (std::size_t i = 0; i < vertices.size(); ++i) {
+            const auto &v = vertices[i];
+            const PositionKey key{std::bit_cast<std::uint32_t>(v.x),
+                                  std::bit_cast<std::uint32_t>(v.y),
+                                  std::bit_cast<std::uint32_t>(v.z)};
+            auto [found, inserted] =
+                positionIds.try_emplace(key, static_cast<std::uint32_t>(positions.size()));
+            if (inserted) {
+                positions.push_back({v.x, v.y, v.z});
+                wedges.emplace_back();
+            }
+            positionOf[i] = found->second;
+            wedges[found->second].push_back(static_cast<std::uint32_t>(i));
+        }
+
+        collapsedTo.resize(positions.size());
+        for (std::uint32_t i = 0; i < collapsedTo.size(); ++i) {
+            collapsedTo[i] = i;
+        }
+
+        Position min = positions.empty() ? Position{} : positions.front(), max = min;
+        for (const auto &p : positions) {
+            min = {std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z)};
+            max = {std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z)};
+        }
+        const double size = std::sqrt((max.x - min.x) * (max.x - min.x) +
+                                      (max.y - min.y) * (max.y - min.y) +
+                                      (max.z - min.z) * (max.z - min.z));
+        maxError = (MAX_ERROR_RATIO * size) * (MAX_ERROR_RATIO * size);
+
+        // Each position starts with the planes of the triangles around it
+        quadrics.resize(positions.size());
+        for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+            const std::array<std::uint32_t, 3> triangle{indices[i], indices[i + 1],
+                                                        indices[i + 2]};
+            const auto &a = positions[positionOf[triangle[0]]];
+            Position normal = cross(a, positions[positionOf[triangle[1]]],
+                                    positions[positionOf[triangle[2]]]);
+            const double length = std::sqrt(dot(normal, normal));
+            if (length > 0.0) {
+                normal = {normal.x / length, normal.y / length, normal.z / length};
+                Quadric plane;
+                plane.addPlane(normal.x, normal.y, normal.z, -dot(normal, a));
+                for (std::uint32_t corner : triangle) {
+                    quadrics[positionOf[corner]] += plane;
+                }
+            }
+            triangles.push_back(triangle);
+        }
+    }
+
+    std::vector<std::vector<std::uint32_t>> run(const std::vector<double> &triangleRatios) {
+        std::vector<std::vector<std::uint32_t>> levels;
+        const std::size_t originalCount = triangles.size();
+        std::size_t previousCount = originalCount;
+        for (double ratio : triangleRatios) {
+            const auto target = static_cast<std::size_t>(originalCount * ratio);
+            while (removeDegenerateTriangles() > target && collapsePass(target) > 0) {
+            }
+            removeDegenerateTriangles();
+            if (triangles.size() > previousCount * MIN_REDUCTION) {
+                break;
+            }
+            levels.push_back(buildIndices());
+            previousCount = triangles.size();
+        }
+        return levels;
+    }
+
+  private:
+    std::uint32_t resolve(std::uint32_t position) {
+        while (collapsedTo[position] != position) {
+            collapsedTo[position] = collapsedTo[collapsedTo[position]];
+            position = collapsedTo[position];
+        }
+        return position;
+    }
+
+    std::array<std::uint32_t, 3> resolvedTriangle(const std::array<std::uint32_t, 3> &triangle) {
+        return {resolve(positionOf[triangle[0]]), resolve(positionOf[triangle[1]]),
+                resolve(positionOf[triangle[2]])};
+    }
+
+    std::size_t removeDegenerateTriangles() {
+        std::erase_if(triangles, [this](const auto &triangle) {
+            const auto p = resolvedTriangle(triangle);
+            return p[0] == p[1] || p[1] == p[2] || p[0] == p[2];
+        });
+        return triangles.size();
+    }
+
+    // Collapses the cheapest edges until target is reached, touching each neighbourhood at most
+    // once so that the checks made against the current triangles stay valid. Returns the number
+    // of collapses made.
+    std::size_t collapsePass(std::size_t target) {
+        std::vector<std::array<std::uint32_t, 3>> current;
+        current.reserve(triangles.size());
+        for (const auto &triangle : triangles) {
+            current.push_back(resolvedTriangle(triangle));
+        }
+
+        // Edges used by a single triangle are on the boundary of the section and stay put
+        std::unordered_map<std::uint64_t, std::uint32_t> edgeUses;
+        for (const auto &triangle : current) {
+            for (int i = 0; i < 3; ++i) {
+                const std::uint32_t a = triangle[i], b = triangle[(i + 1) % 3];
+                ++edgeUses[static_cast<std::uint64_t>(std::min(a, b)) << 32 | std::max(a, b)];
+            }
+        }
+        std::vector<bool> locked(positions.size(), false);
+        for (const auto &[edge, uses] : edgeUses) {
+            if (uses == 1) {
+                locked[edge >> 32] = true;
+                locked[edge & 0xFFFFFFFF] = true;
+            }
+        }
+
+        // Triangles around each position
+        std::vector<std::uint32_t> firstTriangle(positions.size() + 1, 0);
+        for (const auto &triangle : current) {
+            for (std::uint32_t p : triangle) {
+                ++firstTriangle[p + 1];
+            }
+        }
+        for (std::size_t i = 1; i < firstTriangle.size(); ++i) {
+            firstTriangle[i] += firstTriangle[i - 1];
+        }
+        std::vector<std::uint32_t> adjacent(firstTriangle.back());
+        std::vector<std::uint32_t> filled(firstTriangle.begin(), firstTriangle.end() - 1);
+        for (std::uint32_t t = 0; t < current.size(); ++t) {
+            for (std::uint32_t p : current[t]) {
+                adjacent[filled[p]++] = t;
+            }
+        }
+
+        std::vector<Collapse> collapses;
+        collapses.reserve(edgeUses.size());
+        for (const auto &[edge, uses] : edgeUses) {
+            const auto a = static_cast<std::uint32_t>(edge >> 32);
+            const auto b = static_cast<std::uint32_t>(edge & 0xFFFFFFFF);
+            const double costAB = locked[a] ? maxError * 2 : quadrics[a].error(positions[b]);
+            const double costBA = locked[b] ? maxError * 2 : quadrics[b].error(positions[a]);
+            if (costAB <= costBA) {
+                collapses.push_back({costAB, a, b});
+            } else {
+                collapses.push_back({costBA, b, a});
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(),
+                  [](const Collapse &x, const Collapse &y) { return x.cost < y.cost; });
+
+        std::vector<bool> touched(positions.size(), false);
+        std::size_t remaining = current.size();
+        std::size_t collapsed = 0;
+        for (const auto &[cost, from, to] : collapses) {
+            if (remaining <= target || cost > maxError) {
+                break;
+            }
+            if (touched[from] || touched[to]) {
+                continue;
+            }
+
+            const auto begin = adjacent.begin() + firstTriangle[from];
+            const auto end = adjacent.begin() + firstTriangle[from + 1];
+            bool flips = false;
+            std::size_t removed = 0;
+            for (auto t = begin; t != end && !flips; ++t) {
+                const auto &triangle = current[*t];
+                if (std::ranges::find(triangle, to) != triangle.end()) {
+                    ++removed;
+                    continue;
+                }
+                // Moving the corner must not turn the triangle over
+                std::array<Position, 3> corners;
+                for (int i = 0; i < 3; ++i) {
+                    corners[i] = positions[triangle[i] == from ? to : triangle[i]];
+                }
+                const Position before = cross(positions[triangle[0]], positions[triangle[1]],
+                                              positions[triangle[2]]);
+                const Position after = cross(corners[0], corners[1], corners[2]);
+                flips = dot(before, after) <= 0.0;
+            }
+            if (flips) {
+                continue;
+            }
+
+            collapsedTo[from] = to;
+            quadrics[to] += quadrics[from];
+            remaining -= removed;
+            ++collapsed;
+            touched[from] = touched[to] = true;
+            for (auto t = begin; t != end; ++t) {
+                for (std::uint32_t p : current[*t]) {
+                    touched[p] = true;
+                }
+            }
+        }
+        return collapsed;
+    }
+
+    // The surviving triangles as vertex indices. A corner whose position collapsed takes the
+    // wedge of the new position with the closest attributes.
+    std::vector<std::uint32_t> buildIndices() {
+        std::vector<std::uint32_t> indices;
+        indices.reserve(triangles.size() * 3);
+        for (const auto &triangle : triangles) {
+            for (std::uint32_t vertex : triangle) {
+                const std::uint32_t position = resolve(positionOf[vertex]);
+                indices.push_back(position == positionOf[vertex] ? vertex
+                                                                 : closestWedge(vertex, position));
+            }
+        }
+        return indices;
+    }
+
+    std::uint32_t closestWedge(std::uint32_t vertex, std::uint32_t position) const {
+        const auto &v = vertices[vertex];
+        std::uint32_t best = wedges[position].front();
+        double bestDistance = std::numeric_limits<double>::max();
+        for (std::uint32_t wedge : wedges[position]) {
+            const auto &w = vertices[wedge];
+            const double distance = (w.u - v.u) * (w.u - v.u) + (w.v - v.v) * (w.v - v.v) +
+                                    (w.nx - v.nx) * (w.nx - v.nx) + (w.ny - v.ny) * (w.ny - v.ny) +
+                                    (w.nz - v.nz) * (w.nz - v.nz);
+            if (distance < bestDistance) {
+                bestDistance = distance;
+                best = wedge;
+            }
+        }
+        return best;
+    }
+
+    const std::vector<PackedVertex> &vertices;
+    std::vector<Position> positions;
+    std::vector<std::uint32_t> positionOf;               // Vertex -> position
+    std::vector<std::vector<std::uint32_t>> wedges;      // Position -> vertices
+    std::vector<std::uint32_t> collapsedTo;              // Position -> position it merged into
+    std::vector<Quadric> quadrics;                       // Per position
+    std::vector<std::array<std::uint32_t, 3>> triangles; // As vertex indices
+    double maxError{0.0};
+};
+
+} // namespace
+
+std::vector<std::vector<std::uint32_t>>
+MeshSimplifier::simplify(const std::vector<PackedVertex> &vertices,
+                         const std::vector<std::uint32_t> &indices,
+                         const std::vector<double> &triangleRatios) {
+    Simplifier simplifier(vertices, indices);
+    return simplifier.run(triangleRatios);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "Mesh.h"
+#include <cstdint>
+#include <vector>
+
+// Quadric error mesh simplification for building levels of detail
+namespace MeshSimplifier {
+// Simplifies a triangle list by collapsing edges onto one of their endpoints, cheapest first by
+// quadric error, so no vertex is moved or created and every level can be drawn from the original
+// vertex array. Boundary edges are kept in place so that neighbouring sections still meet.
+//
+// Returns one index list per entry of triangleRatios (the fraction of the original triangles to
+// keep, decreasing). Stops early when a level can't get meaningfully smaller than the previous
+// one without exceeding the error limit, so fewer levels than requested may come back.
+std::vector<std::vector<std::uint32_t>> simplify(const std::vector<PackedVertex> &vertices,
+                                                 const std::vector<std::uint32_t> &indices,
+                                                 const std::vector<double> &triangleRatios);
+}
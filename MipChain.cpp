@@ -0,0 +1,275 @@
+#include "MipChain.h"
+#include "FileStamp.h"
+#include "Trace.h"
+#include "VirtualFileSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+constexpr char MAGIC[4]{'M', 'I', 'P', 'C'};
+
+struct Header {
+    char magic[4];
+    std::uint32_t version;
+    std::uint64_t sourceSize;
+    std::int64_t sourceModified;
+    std::uint32_t width; // Of level 0, always a power of two
+    std::uint32_t height;
+    std::uint32_t channels;
+    std::uint32_t levelCount;
+};
+
+std::size_t levelBytes(int width, int height, int channels, int levelCount) {
+    std::size_t bytes = 0;
+    for (int level = 0; level < levelCount; ++level) {
+        bytes += static_cast<std::size_t>(width) * height * channels;
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+    return bytes;
+}
+
+int largestPowerOfTwo(int value) {
+    int power = 1;
+    while (power * 2 <= value) {
+        power *= 2;
+    }
+    return power;
+}
+
+// Shrinks one axis by averaging the source pixels each destination pixel covers, weighting the
+// partially covered ones by their coverage. This is the same filtering gluScaleImage uses.
+std::vector<float> shrinkAxis(const std::vector<float> &source, int width, int height,
+                              int channels, int newSize, bool horizontal) {
+    const int oldSize = horizontal ? width : height;
+    const int newWidth = horizontal ? newSize : width;
+    const int newHeight = horizontal ? height : newSize;
+    if (newSize == oldSize) {
+        return source;
+    }
+    std::vector<float> result(static_cast<std::size_t>(newWidth) * newHeight * channels, 0.0f);
+
+    const double ratio = static_cast<double>(oldSize) / newSize;
+    for (int y = 0; y < newHeight; ++y) {
+        for (int x = 0; x < newWidth; ++x) {
+            const int target = horizontal ? x : y;
+            const double start = target * ratio;
+            const double end = start + ratio;
+            float *out = &result[(static_cast<std::size_t>(y) * newWidth + x) * channels];
+            for (int i = static_cast<int>(start); i < end && i < oldSize; ++i) {
+                const double covered = std::min<double>(end, i + 1) - std::max<double>(start, i);
+                const double weight = covered / ratio;
+                const int sx = horizontal ? i : x;
+                const int sy = horizontal ? y : i;
+                const float *in = &source[(static_cast<std::size_t>(sy) * width + sx) * channels];
+                for (int c = 0; c < channels; ++c) {
+                    out[c] += static_cast<float>(in[c] * weight);
+                }
+            }
+        }
+    }
+    return result;
+}
+
+// Level 0 rescaled to powers of two, like gluBuild2DMipmaps does, followed by 2x2 box filtered
+// levels down to 1x1
+void buildChain(const TextureLoader::Image &source, TextureLoader::Image &chain) {
+    const int channels = source.channels;
+    int width = largestPowerOfTwo(source.width);
+    int height = largestPowerOfTwo(source.height);
+
+    std::vector<float> level(source.pixels.begin(), source.pixels.end());
+    level = shrinkAxis(level, source.width, source.height, channels, width, true);
+    level = shrinkAxis(level, width, source.height, channels, height, false);
+
+    chain.width = width;
+    chain.height = height;
+    chain.channels = channels;
+    chain.mipLevels = 0;
+    chain.pixels.clear();
+    while (true) {
+        for (float value : level) {
+            const float rounded = std::clamp(value + 0.5f, 0.0f, 255.0f);
+            chain.pixels.push_back(static_cast<unsigned char>(rounded));
+        }
+        ++chain.mipLevels;
+        if (width == 1 && height == 1) {
+            break;
+        }
+
+        const int nextWidth = std::max(1, width / 2);
+        const int nextHeight = std::max(1, height / 2);
+        const int stepX = width / nextWidth;
+        const int stepY = height / nextHeight;
+        std::vector<float> next(static_cast<std::size_t>(nextWidth) * nextHeight * channels, 0.0f);
+        for (int y = 0; y < nextHeight; ++y) {
+            for (int x = 0; x < nextWidth; ++x) {
+                float *out = &next[(static_cast<std::size_t>(y) * nextWidth + x) * channels];
+                for (int dy = 0; dy < stepY; ++dy) {
+                    for (int dx = 0; dx < stepX; ++dx) {
+                        const std::size_t sy = static_cast<std::size_t>(y) * stepY + dy;
+                        const std::size_t sx = static_cast<std::size_t>(x) * stepX + dx;
+                        const float *in = &level[(sy * width + sx) * channels];
+                        for (int c = 0; c < channels; ++c) {
+                            out[c] += in[c] / (stepX * stepY);
+                        }
+                    }
+                }
+            }
+        }
+        level = std::move(next);
+        width = nextWidth;
+        height = nextHeight;
+    }
+}
+
+// Chains are stored top row first, as the image file is
+void flipLevels(TextureLoader::Image &image) {
+    int width = image.width;
+    int height = image.height;
+    unsigned char *level = image.pixels.data();
+    std::vector<unsigned char> row;
+    for (int i = 0; i < image.mipLevels; ++i) {
+        const std::size_t rowBytes = static_cast<std::size_t>(width) * image.channels;
+        row.resize(rowBytes);
+        for (int top = 0, bottom = height - 1; top < bottom; ++top, --bottom) {
+            std::memcpy(row.data(), level + top * rowBytes, rowBytes);
+            std::memcpy(level + top * rowBytes, level + bottom * rowBytes, rowBytes);
+            std::memcpy(level + bottom * rowBytes, row.data(), rowBytes);
+        }
+        level += rowBytes * height;
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+}
+
+} // namespace
+
+std::string MipChain::chainPath(const std::string &imagePath) {
+    return std::filesystem::path(imagePath).replace_extension(".mipchain").string();
+}
+
+bool MipChain::load(const std::string &imagePath, const bool flipVertically,
+                    TextureLoader::Image &image) {
+    TRACE_SCOPE("Load mip chain", imagePath);
+    auto &fileSystem = VirtualFileSystem::getInstance();
+    FileStamp source;
+    AssetFile file;
+    if (!fileSystem.stat(imagePath, source) || !fileSystem.open(chainPath(imagePath), file) ||
+        file.size() < sizeof(Header)) {
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, file.data(), sizeof(Header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        header.sourceSize != source.size || header.sourceModified != source.modified ||
+        header.width == 0 || header.height == 0 || header.width > 1u << 15 ||
+        header.height > 1u << 15 || (header.channels != 3 && header.channels != 4) ||
+        header.levelCount == 0 || header.levelCount > 32) {
+        return false;
+    }
+    const std::size_t bytes = levelBytes(header.width, header.height, header.channels,
+                                         static_cast<int>(header.levelCount));
+    if (file.size() - sizeof(Header) != bytes) {
+        return false;
+    }
+
+    image.width = static_cast<int>(header.width);
+    image.height = static_cast<int>(header.height);
+    image.channels = static_cast<int>(header.channels);
+    image.mipLevels = static_cast<int>(header.levelCount);
+    const auto *pixels = reinterpret_cast<const unsigned char *>(file.data()) + sizeof(Header);
+    image.pixels.assign(pixels, pixels + bytes);
+    if (flipVertically) {
+        flipLevels(image);
+    }
+    return true;
+}
+
+bool MipChain::bake(const std::string &imagePath) {
+    TRACE_SCOPE("Bake mip chain", imagePath);
+    FileStamp source;
+    if (!FileStamp::read(imagePath, source)) {
+        std::cerr << "Failed to read image: " << imagePath << std::endl;
+        return false;
+    }
+
+    TextureLoader::Image image;
+    // Always from the image file itself, never from an existing chain
+    if (!TextureLoader::decodeImage(imagePath, false, image)) {
+        return false;
+    }
+    if (image.channels != 3 && image.channels != 4) {
+        std::cerr << "Unsupported channel count " << image.channels << ": " << imagePath
+                  << std::endl;
+        return false;
+    }
+
+    TextureLoader::Image chain;
+    buildChain(image, chain);
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.sourceSize = source.size;
+    header.sourceModified = source.modified;
+    header.width = static_cast<std::uint32_t>(chain.width);
+    header.height = static_cast<std::uint32_t>(chain.height);
+    header.channels = static_cast<std::uint32_t>(chain.channels);
+    header.levelCount = static_cast<std::uint32_t>(chain.mipLevels);
+
+    // Write to a temporary file first so a half-written chain is never picked up
+    const std::string path = chainPath(imagePath);
+    const std::string temporaryPath = path + ".tmp";
+    bool written = false;
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(chain.pixels.data()), chain.pixels.size());
+        written = static_cast<bool>(file);
+    }
+
+    std::error_code error;
+    if (written) {
+        std::filesystem::rename(temporaryPath, path, error);
+    }
+    if (!written || error) {
+        std::filesystem::remove(temporaryPath, error);
+        std::cerr << "Failed to write mip chain: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void MipChain::bakeDirectory(const std::string &root) {
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    int baked = 0, fresh = 0, failed = 0;
+
+    for (const auto &entry : std::filesystem::recursive_directory_iterator(root)) {
+        if (!entry.is_regular_file() || entry.path().extension() != ".png") {
+            continue;
+        }
+        const std::string imagePath = entry.path().generic_string();
+
+        TextureLoader::Image existing;
+        if (load(imagePath, false, existing)) {
+            ++fresh;
+        } else if (bake(imagePath)) {
+            std::cout << "Baked " << chainPath(imagePath) << std::endl;
+            ++baked;
+        } else {
+            ++failed;
+        }
+    }
+
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << "Mip chains: " << baked << " baked, " << fresh << " up to date, " << failed
+              << " failed in " << seconds << " s" << std::endl;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "TextureLoader.h"
+#include <cstdint>
+#include <string>
+
+// Pre-generated mipmaps (.mipchain) baked next to a source image, so loading a texture only has to
+// upload each level instead of running gluBuild2DMipmaps. Like the mesh cache, the file records
+// the size and modification time of the image it was built from and is ignored once they change.
+namespace MipChain {
+// Bump whenever the file layout or the way levels are built changes
+constexpr std::uint32_t VERSION{1};
+
+std::string chainPath(const std::string &imagePath);
+// Fills image with every level of the chain if it exists and is still fresh
+bool load(const std::string &imagePath, const bool flipVertically, TextureLoader::Image &image);
+// Builds the chain for one image. Returns false if the image couldn't be read or written.
+bool bake(const std::string &imagePath);
+// Bakes every PNG under root that has no fresh chain yet
+void bakeDirectory(const std::string &root);
+}
@@ -0,0 +1,132 @@
+#include "ModelRegistry.h"
+#include "AssetStreamer.h"
+#include <cstdio>
+#include <filesystem>
+#include <system_error>
+
+std::string ModelRegistry::canonicalPath(const std::string &path) {
+    std::error_code error;
+    auto canonical = std::filesystem::weakly_canonical(path, error);
+    return error ? path : canonical.generic_string();
+}
+
+std::shared_ptr<Object> ModelRegistry::load(const std::string &path) {
+    const std::string key = canonicalPath(path);
+    if (auto entry = models.find(key); entry != models.end()) {
+        if (!entry->second.model->isLoaded()) {
+            // Requested with loadAsync and still on its way
+            AssetStreamer::getInstance().flush();
+        }
+        return entry->second.model;
+    }
+
+    auto model = std::make_shared<Object>();
+    model->loadFromFile(path);
+    models.emplace(key, Entry{path, model});
+    watchSources(key);
+    return model;
+}
+
+std::shared_ptr<Object> ModelRegistry::loadAsync(const std::string &path) {
+    const std::string key = canonicalPath(path);
+    if (auto entry = models.find(key); entry != models.end()) {
+        return entry->second.model;
+    }
+
+    auto model = std::make_shared<Object>();
+    AssetStreamer::getInstance().enqueue([model, path] { model->prepare(path); },
+                                         [model, key] {
+                                             model->upload();
+                                             getInstance().watchSources(key);
+                                         });
+    models.emplace(key, Entry{path, model});
+    return model;
+}
+
+long ModelRegistry::getReferenceCount(const std::string &path) const {
+    auto entry = models.find(canonicalPath(path));
+    // The registry's own handle doesn't count
+    return entry == models.end() ? 0 : entry->second.model.use_count() - 1;
+}
+
+void ModelRegistry::releaseUnused() {
+    for (auto entry = models.begin(); entry != models.end();) {
+        // Models still streaming in are referenced by their pending load
+        if (entry->second.model.use_count() == 1) {
+            for (const auto watch : entry->second.watches) {
+                FileWatcher::getInstance().unwatch(watch);
+            }
+            entry->second.model->releaseResources();
+            entry = models.erase(entry);
+        } else {
+            ++entry;
+        }
+    }
+}
+
+void ModelRegistry::watchSources(const std::string &key) {
+    auto entry = models.find(key);
+    if (entry == models.end()) {
+        return;
+    }
+    auto &watcher = FileWatcher::getInstance();
+    for (const auto watch : entry->second.watches) {
+        watcher.unwatch(watch);
+    }
+    entry->second.watches.clear();
+    // Materials may have been added or removed, so the list is rebuilt after every load
+    for (const auto &file : entry->second.model->getSourceFiles()) {
+        if (const auto watch = watcher.watch(file, [key] { getInstance().reload(key); })) {
+            entry->second.watches.push_back(watch);
+        }
+    }
+}
+
+void ModelRegistry::reload(const std::string &key) {
+    auto entry = models.find(key);
+    if (entry == models.end()) {
+        return;
+    }
+    auto replacement = std::make_shared<Object>();
+    AssetStreamer::getInstance().enqueue(
+        [replacement, path = entry->second.path] { replacement->prepare(path); },
+        [replacement, key] {
+            replacement->upload();
+            auto &models = getInstance().models;
+            auto entry = models.find(key);
+            // A file caught halfway through saving leaves the model as it was
+            if (entry != models.end() && !replacement->isEmpty()) {
+                entry->second.model->swapContents(*replacement);
+                getInstance().watchSources(key);
+            }
+            // Frees whatever the replacement ended up holding, usually the old version
+            replacement->releaseResources();
+        });
+}
+
+void ModelRegistry::printReport() const {
+    std::size_t totalGeometry = 0, totalTextures = 0;
+    std::printf("%-72s %5s %12s %12s %7s %14s\n", "Model", "Refs", "RAM KiB", "Texture KiB",
+                "Welded", "ACMR");
+    for (const auto &[key, entry] : models) {
+        if (!entry.model->isLoaded()) {
+            std::printf("%-72s (loading)\n", entry.path.c_str());
+            continue;
+        }
+        const std::size_t geometry = entry.model->getGeometryBytes();
+        const std::size_t textures = entry.model->getTextureBytes();
+        totalGeometry += geometry;
+        totalTextures += textures;
+        // Only known for meshes reordered on this load, not ones read from the binary cache
+        char acmr[32] = "-";
+        if (const auto &reordering = entry.model->getReordering()) {
+            std::snprintf(acmr, sizeof(acmr), "%.3f -> %.3f", reordering->before.getAcmr(),
+                          reordering->after.getAcmr());
+        }
+        std::printf("%-72s %5ld %12.1f %12.1f %6.2fx %14s\n", entry.path.c_str(),
+                    entry.model.use_count() - 1, geometry / 1024.0, textures / 1024.0,
+                    entry.model->getWeldRatio(), acmr);
+    }
+    std::printf("%-72s %5s %12.1f %12.1f\n", "Total", "", totalGeometry / 1024.0,
+                totalTextures / 1024.0);
+}
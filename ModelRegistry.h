@@ -0,0 +1,48 @@
+#pragma once
+
+#include "FileWatcher.h"
+#include "Object.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Hands out shared handles to loaded models so every OBJ is parsed and uploaded only once, no
+// matter how many scenes use it. When FileWatcher is on, a model whose OBJ or MTL files change is
+// loaded again in the background and swapped in place, so every handle sees the new version.
+class ModelRegistry {
+  public:
+    static ModelRegistry &getInstance() {
+        static ModelRegistry instance;
+        return instance;
+    }
+
+    // Returns the model for path, loading it the first time it is requested
+    std::shared_ptr<Object> load(const std::string &path);
+    // Like load, but a new model is loaded through AssetStreamer and isn't renderable until
+    // isLoaded() turns true
+    std::shared_ptr<Object> loadAsync(const std::string &path);
+    // Number of handles to the model held outside the registry (0 if it isn't loaded)
+    long getReferenceCount(const std::string &path) const;
+    // Frees the models (and their GL resources) that nobody holds a handle to any more
+    void releaseUnused();
+    // Prints the handle count, resident memory, how much welding shrank the vertices and how much
+    // reordering improved the vertex cache use of every loaded model
+    void printReport() const;
+
+  private:
+    ModelRegistry() = default;
+
+    static std::string canonicalPath(const std::string &path);
+    // Watches the files the model under key was loaded from, replacing any earlier watches
+    void watchSources(const std::string &key);
+    // Loads the model under key again on a worker thread and swaps it in on the GL thread
+    void reload(const std::string &key);
+
+    struct Entry {
+        std::string path; // As first requested, used for display
+        std::shared_ptr<Object> model;
+        std::vector<FileWatcher::WatchId> watches{};
+    };
+    std::unordered_map<std::string, Entry> models; // Keyed by canonical path
+};
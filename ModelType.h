@@ -10,4 +10,9 @@ enum class ModelType {
     FenceBL = 21,
     FenceBR = 23,
     Flowers1 = 30,
+    // Buildings
+    House,
+    PokemonResearchLab,
+    PokemonCenter,
+    PokeMart,
 };
\ No newline at end of file
@@ -0,0 +1,341 @@
+#include "ObjParser.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include "VirtualFileSystem.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+namespace {
+
+bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+std::string_view readToken(const char *&p, const char *end) {
+    while (p < end && isBlank(*p)) {
+        ++p;
+    }
+    const char *start = p;
+    while (p < end && !isBlank(*p)) {
+        ++p;
+    }
+    return {start, static_cast<std::size_t>(p - start)};
+}
+
+double readDouble(const char *&p, const char *end) {
+    while (p < end && isBlank(*p)) {
+        ++p;
+    }
+    // std::from_chars doesn't accept an explicit plus sign
+    if (p < end && *p == '+') {
+        ++p;
+    }
+    double value = 0.0;
+    p = std::from_chars(p, end, value).ptr;
+    return value;
+}
+
+// Reads a 1-based OBJ index and converts it to 0-based. Empty indices (as in "1//3") become -1.
+int readIndex(const char *&p, const char *end) {
+    int value = 0;
+    const char *next = std::from_chars(p, end, value).ptr;
+    if (next == p) {
+        return -1;
+    }
+    p = next;
+    return value - 1;
+}
+
+// Statements that depend on the parser state (current group) are recorded while the chunks are
+// parsed and replayed in file order when they are merged
+struct Statement {
+    enum class Kind { Faces, Group, UseMaterial, MaterialLibrary };
+
+    Kind kind;
+    std::string_view argument;     // Group, material or library name
+    std::size_t first{0}, last{0}; // Range of Chunk::indices covered by a run of faces
+};
+
+// Everything parsed from a line-aligned piece of the file
+struct Chunk {
+    std::string_view text;
+    std::vector<Vertex> vertices;
+    std::vector<TextureCoord> textureCoords;
+    std::vector<Normal> normals;
+    std::vector<VertexIndex> indices;
+    std::vector<Statement> statements;
+    std::vector<std::string_view> unknownKeywords;
+};
+
+// Only files at least this big are split across threads
+constexpr std::size_t PARALLEL_THRESHOLD{256 * 1024};
+constexpr std::size_t MIN_CHUNK_SIZE{64 * 1024};
+
+// Counts the vertex attribute records so the arrays can be allocated once
+void reserveAttributes(Chunk &chunk) {
+    std::size_t vertices = 0, textureCoords = 0, normals = 0, faces = 0;
+    const char *p = chunk.text.data();
+    const char *end = p + chunk.text.size();
+    while (p + 1 < end) {
+        if (p[0] == 'v') {
+            switch (p[1]) {
+            case ' ':
+            case '\t':
+                ++vertices;
+                break;
+            case 't':
+                ++textureCoords;
+                break;
+            case 'n':
+                ++normals;
+                break;
+            }
+        } else if (p[0] == 'f') {
+            ++faces;
+        }
+        const void *newline = std::memchr(p, '\n', end - p);
+        if (newline == nullptr) {
+            break;
+        }
+        p = static_cast<const char *>(newline) + 1;
+    }
+    chunk.vertices.reserve(vertices);
+    chunk.textureCoords.reserve(textureCoords);
+    chunk.normals.reserve(normals);
+    chunk.indices.reserve(faces * 3);
+}
+
+void parseChunk(Chunk &chunk) {
+    reserveAttributes(chunk);
+
+    std::vector<VertexIndex> corners;
+
+    const char *p = chunk.text.data();
+    const char *const end = p + chunk.text.size();
+    while (p < end) {
+        const void *newline = std::memchr(p, '\n', end - p);
+        const char *lineEnd = newline ? static_cast<const char *>(newline) : end;
+
+        if (*p != '#') { // Skip comments
+            std::string_view keyword = readToken(p, lineEnd);
+
+            if (keyword == "v") {
+                Vertex vertex;
+                vertex.x = readDouble(p, lineEnd);
+                vertex.y = readDouble(p, lineEnd);
+                vertex.z = readDouble(p, lineEnd);
+                chunk.vertices.push_back(vertex);
+            } else if (keyword == "vn") {
+                Normal normal;
+                normal.nx = readDouble(p, lineEnd);
+                normal.ny = readDouble(p, lineEnd);
+                normal.nz = readDouble(p, lineEnd);
+                chunk.normals.push_back(normal);
+            } else if (keyword == "vt") {
+                TextureCoord textureCoord;
+                textureCoord.u = readDouble(p, lineEnd);
+                textureCoord.v = readDouble(p, lineEnd);
+                chunk.textureCoords.push_back(textureCoord);
+            } else if (keyword == "f") {
+                corners.clear();
+                while (true) {
+                    while (p < lineEnd && isBlank(*p)) {
+                        ++p;
+                    }
+                    if (p == lineEnd) {
+                        break;
+                    }
+
+                    // vertex/texture/normal
+                    VertexIndex corner{readIndex(p, lineEnd), -1, -1};
+                    if (p < lineEnd && *p == '/') {
+                        ++p;
+                        corner.texCoord = readIndex(p, lineEnd);
+                        if (p < lineEnd && *p == '/') {
+                            ++p;
+                            corner.normal = readIndex(p, lineEnd);
+                        }
+                    }
+                    // Skip whatever is left of a malformed token
+                    while (p < lineEnd && !isBlank(*p)) {
+                        ++p;
+                    }
+                    corners.push_back(corner);
+                }
+
+                // Consecutive faces extend the same run
+                auto &statements = chunk.statements;
+                if (statements.empty() || statements.back().kind != Statement::Kind::Faces) {
+                    statements.push_back({Statement::Kind::Faces, {}, chunk.indices.size()});
+                }
+
+                // Triangulate as a fan so quads and polygons still render as GL_TRIANGLES
+                for (std::size_t i = 2; i < corners.size(); ++i) {
+                    chunk.indices.push_back(corners[0]);
+                    chunk.indices.push_back(corners[i - 1]);
+                    chunk.indices.push_back(corners[i]);
+                }
+                statements.back().last = chunk.indices.size();
+            } else if (keyword == "g") {
+                chunk.statements.push_back({Statement::Kind::Group, readToken(p, lineEnd)});
+            } else if (keyword == "mtllib") {
+                chunk.statements.push_back(
+                    {Statement::Kind::MaterialLibrary, readToken(p, lineEnd)});
+            } else if (keyword == "usemtl") {
+                chunk.statements.push_back({Statement::Kind::UseMaterial, readToken(p, lineEnd)});
+            } else if (keyword == "s" || keyword == "o") {
+                // Smoothing groups and object names don't affect how the mesh is drawn
+            } else if (!keyword.empty() &&
+                       std::find(chunk.unknownKeywords.begin(), chunk.unknownKeywords.end(),
+                                 keyword) == chunk.unknownKeywords.end()) {
+                chunk.unknownKeywords.push_back(keyword);
+            }
+        }
+
+        p = lineEnd + 1;
+    }
+}
+
+template <typename T> void append(std::vector<T> &destination, const std::vector<T> &source) {
+    destination.insert(destination.end(), source.begin(), source.end());
+}
+
+void mergeChunks(std::vector<Chunk> &chunks, Mesh &mesh) {
+    std::size_t vertices = 0, textureCoords = 0, normals = 0;
+    for (const auto &chunk : chunks) {
+        vertices += chunk.vertices.size();
+        textureCoords += chunk.textureCoords.size();
+        normals += chunk.normals.size();
+    }
+    mesh.vertices.reserve(vertices);
+    mesh.textureCoords.reserve(textureCoords);
+    mesh.normals.reserve(normals);
+
+    // OBJ indices are absolute, so attributes just need to be concatenated in file order
+    std::string currentGroup;
+    std::vector<std::string_view> unknownKeywords;
+    for (auto &chunk : chunks) {
+        append(mesh.vertices, chunk.vertices);
+        append(mesh.textureCoords, chunk.textureCoords);
+        append(mesh.normals, chunk.normals);
+
+        for (const auto &statement : chunk.statements) {
+            switch (statement.kind) {
+            case Statement::Kind::Faces: {
+                auto &indices = mesh.groups[currentGroup].indices;
+                indices.insert(indices.end(), chunk.indices.begin() + statement.first,
+                               chunk.indices.begin() + statement.last);
+                break;
+            }
+            case Statement::Kind::Group:
+                if (!statement.argument.empty()) {
+                    currentGroup = statement.argument;
+                }
+                break;
+            case Statement::Kind::UseMaterial: {
+                auto &group = mesh.groups[currentGroup];
+                if (!statement.argument.empty()) {
+                    group.material = statement.argument;
+                }
+                break;
+            }
+            case Statement::Kind::MaterialLibrary:
+                if (!statement.argument.empty()) {
+                    mesh.materialLibraries.emplace_back(statement.argument);
+                }
+                break;
+            }
+        }
+
+        for (auto keyword : chunk.unknownKeywords) {
+            if (std::find(unknownKeywords.begin(), unknownKeywords.end(), keyword) ==
+                unknownKeywords.end()) {
+                unknownKeywords.push_back(keyword);
+                std::cerr << "OBJ unknown keyword: " << keyword << std::endl;
+            }
+        }
+    }
+}
+
+// Splits text into roughly equal pieces that start at the beginning of a line
+std::vector<Chunk> splitIntoChunks(std::string_view text, std::size_t count) {
+    std::vector<Chunk> chunks;
+    std::size_t start = 0;
+    for (std::size_t i = 1; i < count; ++i) {
+        std::size_t split = text.size() * i / count;
+        if (split <= start) {
+            continue;
+        }
+        split = text.find('\n', split);
+        if (split == std::string_view::npos) {
+            break;
+        }
+        ++split;
+        chunks.emplace_back().text = text.substr(start, split - start);
+        start = split;
+    }
+    chunks.emplace_back().text = text.substr(start);
+    return chunks;
+}
+
+} // namespace
+
+bool ObjParser::parseFile(const std::string &filename, Mesh &mesh, Mode mode) {
+    TRACE_SCOPE("Parse OBJ", filename);
+    AssetFile file;
+    if (!VirtualFileSystem::getInstance().open(filename, file)) {
+        std::cerr << "Failed to open OBJ file: " << filename << std::endl;
+        return false;
+    }
+    parse(file.view(), mesh, mode);
+    return true;
+}
+
+void ObjParser::parse(std::string_view text, Mesh &mesh, Mode mode) {
+    auto &threadPool = ThreadPool::getInstance();
+
+    std::size_t chunkCount = 1;
+    if (mode == Mode::Parallel ||
+        (mode == Mode::Automatic && text.size() >= PARALLEL_THRESHOLD)) {
+        // The calling thread works too
+        chunkCount = std::min(threadPool.getThreadCount() + 1,
+                              std::max<std::size_t>(1, text.size() / MIN_CHUNK_SIZE));
+    }
+
+    std::vector<Chunk> chunks = splitIntoChunks(text, chunkCount);
+    if (chunks.size() == 1) {
+        parseChunk(chunks.front());
+    } else {
+        threadPool.parallelFor(chunks.size(), [&](std::size_t i) { parseChunk(chunks[i]); });
+    }
+
+    mesh = Mesh{};
+    mergeChunks(chunks, mesh);
+    calculateBoundingBox(mesh);
+}
+
+void ObjParser::calculateBoundingBox(Mesh &mesh) {
+    if (mesh.vertices.empty()) {
+        mesh.boundingBox = {};
+        return;
+    }
+
+    Vertex min{std::numeric_limits<double>::max(), std::numeric_limits<double>::max(),
+               std::numeric_limits<double>::max()};
+    Vertex max{std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest(),
+               std::numeric_limits<double>::lowest()};
+
+    for (const auto &vertex : mesh.vertices) {
+        min.x = std::min(min.x, vertex.x);
+        max.x = std::max(max.x, vertex.x);
+        min.y = std::min(min.y, vertex.y);
+        max.y = std::max(max.y, vertex.y);
+        min.z = std::min(min.z, vertex.z);
+        max.z = std::max(max.z, vertex.z);
+    }
+
+    mesh.boundingBox = {min, max};
+}
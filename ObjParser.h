@@ -0,0 +1,19 @@
+#pragma once
+
+#include "Mesh.h"
+#include <string>
+#include <string_view>
+
+namespace ObjParser {
+enum class Mode {
+    Automatic, // Parallel for big files only
+    Serial,
+    Parallel, // Line-aligned chunks parsed on the thread pool and merged in file order
+};
+
+// Maps the file into memory and parses it in place. Returns false if the file can't be opened.
+bool parseFile(const std::string &filename, Mesh &mesh, Mode mode = Mode::Automatic);
+// Parses the contents of an OBJ file. Faces with more than three corners are fan-triangulated.
+void parse(std::string_view text, Mesh &mesh, Mode mode = Mode::Automatic);
+void calculateBoundingBox(Mesh &mesh);
+}
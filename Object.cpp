@@ -1,124 +1,158 @@
 #include "Object.h"
 #include "freeglut.h"
 #include "stb_image.h"
-#include <fstream>
 #include <iostream>
-#include <limits>
 #include <sstream>
 #include <array>
 #include <algorithm>
-#include "TextureLoader.h"
+#include <cmath>
+#include <cstring>
+#include "BufferObjects.h"
+#include "GLState.h"
+#include "Instancing.h"
+#include "MeshBuilder.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "ObjParser.h"
+#include "TextureCache.h"
+#include "Trace.h"
+#include "VertexCodec.h"
+#include "VirtualFileSystem.h"
 
 void Object::loadFromFile(const std::string &filename) {
-    std::ifstream inputFile(filename);
-    if (inputFile.is_open()) {
-        std::string currentGroup;
-
-        std::string line;
-        while (std::getline(inputFile, line)) {
-            if (!line.empty() && line[0] != '#') { // Skip empty lines and comments
-                std::istringstream stream(line);
-                std::string keyword;
-                stream >> keyword;
-
-                if (keyword == "v") {
-                    Vertex vertex;
-                    stream >> vertex.x >> vertex.y >> vertex.z;
-                    vertices.push_back(vertex);
-                } else if (keyword == "vn") {
-                    Normal normal;
-                    stream >> normal.nx >> normal.ny >> normal.nz;
-                    normals.push_back(normal);
-                } else if (keyword == "vt") {
-                    TextureCoord textureCoord;
-                    stream >> textureCoord.u >> textureCoord.v;
-                    textureCoords.push_back(textureCoord);
-                } else if (keyword == "f") {
-                    Face face;
-                    std::string token;
-                    int i = 0;
-                    while (stream >> token) {
-                        std::istringstream tokenStream(token);
-                        std::string index;
-                        std::vector<int> indices;
-
-                        // Retrieve the vertex, texture, and normal indices
-                        while (std::getline(tokenStream, index, '/')) {
-                            indices.push_back(std::stoi(index) - 1); // Adjust for 0-based index
-                        }
-
-                        face.vertex_indices.emplace_back(
-                            std::make_tuple(indices.at(0), indices.at(1), indices.at(2)));
-                    }
-                    groups[currentGroup].faces.emplace_back(face);
-                } else if (keyword == "g") {
-                    stream >> currentGroup;
-                } else if (keyword == "mtllib") {
-                    std::string materialLibrary;
-                    stream >> materialLibrary;
-                    materialLibraries.push_back(materialLibrary);
-                } else if (keyword == "usemtl") {
-                    stream >> groups[currentGroup].material;
-                } else {
-                    std::cerr << "OBJ unknown keyword: " << keyword << std::endl;
-                }
-            }
+    prepare(filename);
+    upload();
+}
+
+void Object::prepare(const std::string &filename) {
+    TRACE_SCOPE("Prepare model", filename);
+    sourceFiles = {filename};
+    reordering.reset();
+    // Prefer the binary cache and only parse the OBJ text when it is missing or stale, or was
+    // built with the other triangle order
+    if (!MeshCache::load(filename, mesh) || mesh.optimizedOrder != MeshOptimizer::isEnabled()) {
+        Mesh parsed;
+        if (!ObjParser::parseFile(filename, parsed)) {
+            return;
         }
-        inputFile.close();
-
-        // Now calculate the min and max coordinates of the vertices
-        if (!vertices.empty()) {
-            double minX = std::numeric_limits<double>::max();
-            double maxX = std::numeric_limits<double>::lowest();
-            double minY = std::numeric_limits<double>::max();
-            double maxY = std::numeric_limits<double>::lowest();
-            double minZ = std::numeric_limits<double>::max();
-            double maxZ = std::numeric_limits<double>::lowest();
-
-            for (const auto &vertex : vertices) {
-                minX = std::min(minX, vertex.x);
-                maxX = std::max(maxX, vertex.x);
-                minY = std::min(minY, vertex.y);
-                maxY = std::max(maxY, vertex.y);
-                minZ = std::min(minZ, vertex.z);
-                maxZ = std::max(maxZ, vertex.z);
-            }
-
-            std::cout << "Min Coordinates: (" << minX << ", " << minY << ", " << minZ << ")\n";
-            std::cout << "Max Coordinates: (" << maxX << ", " << maxY << ", " << maxZ << ")\n";
-
-            boundingBox = {Vertex{minX, minY, minZ}, Vertex{maxX, maxY, maxZ}};
+        MeshBuilder::buildIndexed(parsed, mesh);
+        MeshBuilder::buildLevels(mesh);
+        if (MeshOptimizer::isEnabled()) {
+            const auto before = MeshBuilder::analyzeCache(mesh);
+            MeshBuilder::optimizeOrder(mesh);
+            reordering = Reordering{before, MeshBuilder::analyzeCache(mesh)};
         }
+        MeshCache::save(filename, mesh);
+    }
 
-        for (const auto &materialLibrary : materialLibraries) {
-            loadMaterialLibrary(materialLibrary,
-                                filename.substr(0, filename.find_last_of('/') + 1));
+    if (!mesh.vertices.empty()) {
+        const auto &[min, max] = mesh.boundingBox;
+        std::cout << "Min Coordinates: (" << min.x << ", " << min.y << ", " << min.z << ")\n";
+        std::cout << "Max Coordinates: (" << max.x << ", " << max.y << ", " << max.z << ")\n";
+    }
+
+    for (const auto &materialLibrary : mesh.materialLibraries) {
+        loadMaterialLibrary(materialLibrary, filename.substr(0, filename.find_last_of('/') + 1));
+    }
+    resolveMaterials();
+
+    // Decode the textures here, all at once across the pool, so that the GL thread only has to
+    // upload them
+    std::vector<PendingTexture *> toDecode;
+    std::vector<std::string> paths;
+    for (auto &[id, pending] : pendingTextures) {
+        if (!TextureCache::getInstance().contains(pending.path, true)) {
+            toDecode.push_back(&pending);
+            paths.push_back(pending.path);
         }
     }
+    std::vector<TextureLoader::Image> images;
+    TextureLoader::loadImages(paths, true, images);
+    for (std::size_t i = 0; i < toDecode.size(); ++i) {
+        toDecode[i]->image = std::move(images[i]);
+    }
+}
+
+void Object::upload() {
+    TRACE_SCOPE("Upload model");
+    for (const auto &[id, pending] : pendingTextures) {
+        // Without pixels (already cached, or decoding failed) the cache loads the file itself
+        const TextureLoader::Image *decoded =
+            pending.image.pixels.empty() ? nullptr : &pending.image;
+        materialStates[id].texture =
+            TextureCache::getInstance().acquire(pending.path, true, decoded);
+        std::cout << "Loaded texture: " << pending.path
+                  << " for material: " << materials[id].name << std::endl;
+    }
+    pendingTextures.clear();
+    if (renderPath == RenderPath::BufferObjects && !mesh.vertices.empty()) {
+        createBuffers();
+    }
+    loaded = true;
+}
+
+void Object::createBuffers() {
+    TRACE_SCOPE("Create buffers");
+    std::vector<PackedVertex> vertices;
+    VertexCodec::decode(mesh.vertices, vertices);
+    vertexBuffer = BufferObjects::create();
+    BufferObjects::bind(BufferObjects::ARRAY_BUFFER, vertexBuffer);
+    BufferObjects::upload(BufferObjects::ARRAY_BUFFER, vertices.size() * sizeof(PackedVertex),
+                          vertices.data());
+    BufferObjects::bind(BufferObjects::ARRAY_BUFFER, 0);
+
+    // Every index buffer of every level, one after the other and each aligned to 4 bytes
+    std::vector<unsigned char> indices;
+    const auto append = [&](std::vector<IndexRange> &ranges, const IndexBuffer &buffer) {
+        const std::size_t offset = (indices.size() + 3) / 4 * 4;
+        const void *data = buffer.isShort() ? static_cast<const void *>(buffer.shortIndices.data())
+                                            : buffer.longIndices.data();
+        const std::size_t bytes = buffer.size() * (buffer.isShort() ? sizeof(std::uint16_t)
+                                                                    : sizeof(std::uint32_t));
+        indices.resize(offset + bytes);
+        if (bytes > 0) {
+            std::memcpy(indices.data() + offset, data, bytes);
+        }
+        ranges.push_back({offset, static_cast<GLsizei>(buffer.size()),
+                          static_cast<GLenum>(buffer.isShort() ? GL_UNSIGNED_SHORT
+                                                               : GL_UNSIGNED_INT)});
+    };
+    indexRanges.assign(mesh.sections.size(), {});
+    for (std::size_t i = 0; i < mesh.sections.size(); ++i) {
+        append(indexRanges[i], mesh.sections[i].indices);
+        for (const auto &level : mesh.sections[i].levels) {
+            append(indexRanges[i], level);
+        }
+    }
+    indexBuffer = BufferObjects::create();
+    BufferObjects::bind(BufferObjects::ELEMENT_ARRAY_BUFFER, indexBuffer);
+    BufferObjects::upload(BufferObjects::ELEMENT_ARRAY_BUFFER, indices.size(), indices.data());
+    BufferObjects::bind(BufferObjects::ELEMENT_ARRAY_BUFFER, 0);
 }
 
 void Object::loadMaterialLibrary(const std::string &mtlPath, const std::string &texturePath) {
-    std::ifstream inputFile(texturePath + mtlPath);
-    if (!inputFile) {
+    TRACE_SCOPE("Parse MTL", texturePath + mtlPath);
+    sourceFiles.push_back(texturePath + mtlPath);
+    AssetFile file;
+    if (!VirtualFileSystem::getInstance().open(texturePath + mtlPath, file)) {
         std::cerr << "Failed to open material file: " << mtlPath << std::endl;
     }
 
+    std::istringstream inputFile{std::string(file.view())};
     parseMaterialFile(inputFile);
 
-    for (const auto &[name, material] : materials) {
-        if (!material.map_Kd.empty()) {
-            textures[name] = TextureLoader::loadTexture(texturePath + material.map_Kd);
-            std::cout << "Loaded texture: " << material.map_Kd << " for material: " << name
-                      << std::endl;
+    for (std::size_t id = 0; id < materials.size(); ++id) {
+        // Materials from an earlier library already have their texture queued
+        const auto &material = materials[id];
+        if (!material.map_Kd.empty() && !pendingTextures.contains(id)) {
+            pendingTextures[static_cast<std::uint16_t>(id)].path = texturePath + material.map_Kd;
         }
     }
-
-    inputFile.close();
 }
 
-void Object::parseMaterialFile(std::ifstream &inputFile) {
+void Object::parseMaterialFile(std::istream &inputFile) {
     std::string line;
-    std::string currentMaterial;
+    std::uint16_t currentMaterial = NO_MATERIAL;
 
     while (std::getline(inputFile, line)) {
         if (line.empty() || line[0] == '#') // Skip empty lines and comments
@@ -129,43 +163,92 @@ void Object::parseMaterialFile(std::ifstream &inputFile) {
         stream >> keyword;
 
         if (keyword == "newmtl") {
-            stream >> currentMaterial;
-        } else if (keyword == "Ka") {
-            materials[currentMaterial].Ka = parseColor(stream);
+            std::string name;
+            stream >> name;
+            currentMaterial = internMaterial(name);
+            continue;
+        }
+        if (currentMaterial == NO_MATERIAL) {
+            // Properties before the first newmtl go to a material without a name
+            currentMaterial = internMaterial("");
+        }
+
+        auto &material = materials[currentMaterial];
+        if (keyword == "Ka") {
+            material.Ka = parseColor(stream);
         } else if (keyword == "Kd") {
-            materials[currentMaterial].Kd = parseColor(stream);
+            material.Kd = parseColor(stream);
         } else if (keyword == "Ks") {
-            materials[currentMaterial].Ks = parseColor(stream);
+            material.Ks = parseColor(stream);
         } else if (keyword == "Ke") {
-            materials[currentMaterial].Ke = parseColor(stream);
+            material.Ke = parseColor(stream);
         } else if (keyword == "Tf") {
-            materials[currentMaterial].Tf = parseColor(stream);
+            material.Tf = parseColor(stream);
         } else if (keyword == "Ns") {
-            stream >> materials[currentMaterial].Ns;
+            stream >> material.Ns;
         } else if (keyword == "Ni") {
-            stream >> materials[currentMaterial].Ni;
+            stream >> material.Ni;
         } else if (keyword == "d") {
-            stream >> materials[currentMaterial].d;
+            stream >> material.d;
         } else if (keyword == "illum") {
-            stream >> materials[currentMaterial].illum;
+            stream >> material.illum;
         } else if (keyword == "map_Ka") {
-            stream >> materials[currentMaterial].map_Ka;
+            stream >> material.map_Ka;
         } else if (keyword == "map_Kd") {
-            stream >> materials[currentMaterial].map_Kd;
+            stream >> material.map_Kd;
         } else if (keyword == "map_Ks") {
-            stream >> materials[currentMaterial].map_Ks;
+            stream >> material.map_Ks;
         } else if (keyword == "map_Ns") {
-            stream >> materials[currentMaterial].map_Ns;
+            stream >> material.map_Ns;
         } else if (keyword == "map_d") {
-            stream >> materials[currentMaterial].map_d;
+            stream >> material.map_d;
         } else if (keyword == "map_bump" || keyword == "bump") {
-            stream >> materials[currentMaterial].map_bump;
+            stream >> material.map_bump;
         } else {
             std::cerr << "MTL unknown keyword: " << keyword << std::endl;
         }
     }
 }
 
+std::uint16_t Object::internMaterial(const std::string &name) {
+    if (auto found = materialIds.find(name); found != materialIds.end()) {
+        return found->second;
+    }
+    if (materials.size() == NO_MATERIAL) {
+        std::cerr << "Too many materials, ignoring: " << name << std::endl;
+        return NO_MATERIAL - 1;
+    }
+    const auto id = static_cast<std::uint16_t>(materials.size());
+    materials.emplace_back().name = name;
+    materialIds.emplace(name, id);
+    return id;
+}
+
+void Object::resolveMaterials() {
+    materialStates.resize(materials.size());
+    for (std::size_t id = 0; id < materials.size(); ++id) {
+        const auto &material = materials[id];
+        auto &state = materialStates[id];
+        state.ambient = {static_cast<GLfloat>(material.Ka.r), static_cast<GLfloat>(material.Ka.g),
+                         static_cast<GLfloat>(material.Ka.b), 1.0f};
+        state.diffuse = {static_cast<GLfloat>(material.Kd.r), static_cast<GLfloat>(material.Kd.g),
+                         static_cast<GLfloat>(material.Kd.b), 1.0f};
+        state.specular = {static_cast<GLfloat>(material.Ks.r),
+                          static_cast<GLfloat>(material.Ks.g),
+                          static_cast<GLfloat>(material.Ks.b), 1.0f};
+        state.shininess = static_cast<GLfloat>(material.Ns);
+    }
+
+    sectionStates.assign(mesh.sections.size(), SectionState{});
+    for (std::size_t i = 0; i < mesh.sections.size(); ++i) {
+        if (auto id = materialIds.find(mesh.sections[i].material); id != materialIds.end()) {
+            sectionStates[i].material = id->second;
+        }
+    }
+    // Names are no longer needed once everything refers to materials by ID
+    materialIds.clear();
+}
+
 Color Object::parseColor(std::istringstream &stream) {
     Color color;
     stream >> color.r >> color.g >> color.b;
@@ -174,14 +257,41 @@ Color Object::parseColor(std::istringstream &stream) {
 
 void Object::setGroupWithScrollingTexture(const std::string &groupName, double velocityX,
                                           double velocityY) {
-    if (groups.contains(groupName)) {
+    if (std::ranges::any_of(mesh.sections,
+                            [&](const Section &section) { return section.name == groupName; })) {
         scrollingTextures[groupName] = {std::make_pair(velocityX, velocityY),
                                         std::make_pair(0.0f, 0.0f)};
+        linkScrollingTextures();
     } else {
         std::cerr << "Group name not found: " << groupName << std::endl;
     }
 }
 
+void Object::linkScrollingTextures() {
+    for (std::size_t i = 0; i < mesh.sections.size(); ++i) {
+        auto scrollingTexture = scrollingTextures.find(mesh.sections[i].name);
+        sectionStates[i].scrolling =
+            scrollingTexture == scrollingTextures.end() ? nullptr : &scrollingTexture->second;
+    }
+}
+
+void Object::swapContents(Object &replacement) {
+    std::swap(mesh, replacement.mesh);
+    std::swap(decodedVertices, replacement.decodedVertices);
+    std::swap(materials, replacement.materials);
+    std::swap(materialStates, replacement.materialStates);
+    std::swap(sectionStates, replacement.sectionStates);
+    std::swap(pendingTextures, replacement.pendingTextures);
+    std::swap(loaded, replacement.loaded);
+    std::swap(vertexBuffer, replacement.vertexBuffer);
+    std::swap(indexBuffer, replacement.indexBuffer);
+    std::swap(indexRanges, replacement.indexRanges);
+    std::swap(displayLists, replacement.displayLists);
+    std::swap(sourceFiles, replacement.sourceFiles);
+    std::swap(reordering, replacement.reordering);
+    linkScrollingTextures();
+}
+
 void Object::update(const double deltaTime) {
     // Scrolling textures
     for (auto &[name, scrollingTexture] : scrollingTextures) {
@@ -193,124 +303,300 @@ void Object::update(const double deltaTime) {
     }
 }
 
-bool Object::isStatic() const {
-    return scrollingTextures.empty();
+void Object::render() {
+    if (!loaded) {
+        return;
+    }
+
+    const std::size_t level = selectLevel();
+    if (vertexBuffer == 0) {
+        if (displayLists.size() != getLevelCount()) {
+            displayLists.assign(getLevelCount(), 0);
+        }
+        if (displayLists[level] == 0 && !mesh.sections.empty()) {
+            compileLevel(level);
+        }
+    }
+
+    // Sections sharing a material across all the objects are drawn back to back by the queue
+    auto &queue = RenderQueue::getInstance();
+    for (std::size_t i = 0; i < mesh.sections.size(); ++i) {
+        if (mesh.sections[i].vertexCount == 0) {
+            continue;
+        }
+        RenderQueue::State state{0, nullptr, vertexBuffer, indexBuffer};
+        if (const auto material = sectionStates[i].material; material != NO_MATERIAL) {
+            state.texture = materialStates[material].texture;
+            state.material = &materialStates[material];
+        }
+        queue.submit(
+            RenderQueue::Pass::Opaque, state,
+            [](const void *object, std::uintptr_t section) {
+                static_cast<const Object *>(object)->drawSection(section >> 8, section & 0xFF);
+            },
+            this, i << 8 | level);
+    }
+}
+
+void Object::compileLevel(std::size_t level) {
+    // Create the display lists of this level the first time it is drawn
+    TRACE_SCOPE("Compile display list");
+    if (decodedVertices.empty()) {
+        VertexCodec::decode(mesh.vertices, decodedVertices);
+    }
+    displayLists[level] = glGenLists(static_cast<GLsizei>(mesh.sections.size()));
+    for (std::size_t i = 0; i < mesh.sections.size(); ++i) {
+        glNewList(displayLists[level] + static_cast<GLuint>(i), GL_COMPILE);
+        drawGeometry(i, level);
+        glEndList();
+    }
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    // The display lists have their own copy of the vertices
+    decodedVertices.clear();
+    decodedVertices.shrink_to_fit();
 }
 
-void Object::render() {
+void Object::drawSection(std::size_t i, std::size_t level) const {
+    // Scrolling textures are applied around the cached geometry, so only the offset changes
+    // from one frame to the next
+    const ScrollingTexture *scrolling = sectionStates[i].scrolling;
+    if (scrolling != nullptr) {
+        GLState::matrixMode(GL_TEXTURE);
+        GLState::loadIdentity();
+        GLState::translated(scrolling->offset.first, scrolling->offset.second, 0.0);
+        GLState::matrixMode(GL_MODELVIEW);
+    }
+
     glColor3ub(255, 255, 255);
-    glColorMaterial(GL_FRONT, GL_DIFFUSE);
-    glEnable(GL_COLOR_MATERIAL);
+    if (vertexBuffer != 0) {
+        drawGeometry(i, level);
+    } else {
+        glCallList(displayLists[level] + static_cast<GLuint>(i));
+    }
 
-    if (displayListID != 0) {
-        // Display list already exists, just call it
-        glCallList(displayListID);
+    if (scrolling != nullptr) {
+        // Reset the texture matrix
+        GLState::matrixMode(GL_TEXTURE);
+        GLState::loadIdentity();
+        GLState::matrixMode(GL_MODELVIEW);
     }
+}
 
-    // Render the object by hand if the display list is not created or the object is not static
-    if (displayListID == 0) {
-        if (isStatic()) {
-            // Create a new display list if not created and the object is static
-            displayListID = glGenLists(1);
-            glNewList(displayListID, GL_COMPILE);
-        }
+bool Object::applyMaterial(std::size_t i) {
+    const auto &sectionState = sectionStates[i];
+    if (sectionState.material == NO_MATERIAL) {
+        GLState::disable(GL_TEXTURE_2D);
+        return false;
+    }
+
+    // Set the material properties
+    const auto &material = materialStates[sectionState.material];
+    GLState::materialfv(GL_FRONT, GL_AMBIENT, material.ambient.data());
+    GLState::materialfv(GL_FRONT, GL_DIFFUSE, material.diffuse.data());
+    GLState::materialfv(GL_FRONT, GL_SPECULAR, material.specular.data());
+    GLState::materialf(GL_FRONT, GL_SHININESS, material.shininess);
+
+    // Bind texture if the material has one
+    if (material.texture != 0) {
+        GLState::enable(GL_TEXTURE_2D);
+        GLState::bindTexture(GL_TEXTURE_2D, material.texture);
+        return true;
+    }
+    GLState::disable(GL_TEXTURE_2D);
+    return false;
+}
+
+std::size_t Object::getSectionLevel(std::size_t i, std::size_t level) const {
+    // Sections too small to simplify have fewer levels and keep their coarsest one
+    const auto &levels = mesh.sections[i].levels;
+    return levels.empty() ? 0 : std::min(level, levels.size());
+}
 
-        for (const auto &[name, group] : groups) {
-            // Set the material properties
-            if (materials.contains(group.material)) {
-                const auto &material = materials.at(group.material);
-                GLfloat ambient[] = {static_cast<GLfloat>(material.Ka.r),
-                                     static_cast<GLfloat>(material.Ka.g),
-                                     static_cast<GLfloat>(material.Ka.b), 1.0f};
-                GLfloat diffuse[] = {static_cast<GLfloat>(material.Kd.r),
-                                     static_cast<GLfloat>(material.Kd.g),
-                                     static_cast<GLfloat>(material.Kd.b), 1.0f};
-                GLfloat specular[] = {static_cast<GLfloat>(material.Ks.r),
-                                      static_cast<GLfloat>(material.Ks.g),
-                                      static_cast<GLfloat>(material.Ks.b), 1.0f};
-
-                glMaterialfv(GL_FRONT, GL_AMBIENT, ambient);
-                glMaterialfv(GL_FRONT, GL_DIFFUSE, diffuse);
-                glMaterialfv(GL_FRONT, GL_SPECULAR, specular);
-                glMaterialf(GL_FRONT, GL_SHININESS, static_cast<GLfloat>(material.Ns));
-
-                // Bind texture if the material has one
-                if (!material.map_Kd.empty() && textures.contains(group.material)) {
-                    glEnable(GL_TEXTURE_2D);
-                    glBindTexture(GL_TEXTURE_2D, textures.at(group.material));
-
-                    // Apply texture transformation if it's a scrolling texture
-                    // TODO: name is set, but group.name is empty
-                    if (scrollingTextures.contains(name)) {
-                        auto &scrollingTexture = scrollingTextures.at(name);
-                        auto &offset = scrollingTexture.offset;
-
-                        // Apply the offset
-                        glMatrixMode(GL_TEXTURE);
-                        glLoadIdentity();
-                        glTranslated(offset.first, offset.second, 0.0);
-                        glMatrixMode(GL_MODELVIEW);
-                    }
-                } else {
-                    glDisable(GL_TEXTURE_2D);
-                }
-            } else {
-                glDisable(GL_TEXTURE_2D);
-            }
-
-            glBegin(GL_TRIANGLES);
-            // Render the faces
-            for (const auto &face : group.faces) {
-                //// Generate random color
-                // float r = static_cast<float>(std::rand()) / static_cast<float>(RAND_MAX);
-                // float g = static_cast<float>(std::rand()) / static_cast<float>(RAND_MAX);
-                // float b = static_cast<float>(std::rand()) / static_cast<float>(RAND_MAX);
-
-                //// Set the color for the current triangle
-                // glColor3f(r, g, b);
-
-                for (const auto &[vertexIdx, texCoordIdx, normalIdx] : face.vertex_indices) {
-                    if (normalIdx >= 0) {
-                        const auto &n = normals[normalIdx];
-                        glNormal3d(n.nx, n.ny, n.nz);
-                    }
-                    if (texCoordIdx >= 0) {
-                        const auto &tc = textureCoords[texCoordIdx];
-                        glTexCoord2d(tc.u, tc.v);
-                    }
-
-                    const auto &v = vertices[vertexIdx];
-                    glVertex3d(v.x, v.y, v.z);
-                }
-            }
-            glEnd();
-
-            // Reset the texture matrix
-            glMatrixMode(GL_TEXTURE);
-            glLoadIdentity();
-            glMatrixMode(GL_MODELVIEW);
+void Object::drawGeometry(std::size_t i, std::size_t level) const {
+    const auto &section = mesh.sections[i];
+    if (section.vertexCount == 0) {
+        return;
+    }
+    const std::size_t sectionLevel = getSectionLevel(i, level);
+
+    // Render the faces from the welded vertices. With buffers bound, the pointers are byte
+    // offsets into them.
+    if (vertexBuffer != 0) {
+        const IndexRange &range = indexRanges[i][sectionLevel];
+        glInterleavedArrays(GL_T2F_N3F_V3F, 0,
+                            reinterpret_cast<const void *>(section.firstVertex *
+                                                           sizeof(PackedVertex)));
+        glDrawElements(GL_TRIANGLES, range.count, range.type,
+                       reinterpret_cast<const void *>(range.offset));
+    } else {
+        const IndexBuffer &indices =
+            sectionLevel == 0 ? section.indices : section.levels[sectionLevel - 1];
+        glInterleavedArrays(GL_T2F_N3F_V3F, 0, &decodedVertices[section.firstVertex]);
+        if (indices.isShort()) {
+            glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_SHORT,
+                           indices.shortIndices.data());
+        } else {
+            glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT,
+                           indices.longIndices.data());
         }
-        
-        if (isStatic()) {
-            // If static, it's creating the display list, so end it
-            glEndList();
-            // Call the display list (needed to not loose a frame of rendering)
-            glCallList(displayListID);
+    }
+}
+
+bool Object::canRenderInstances() const {
+    return loaded && vertexBuffer != 0 && Instancing::isAvailable();
+}
+
+bool Object::renderInstances(GLuint instances, GLsizei count, double scale) {
+    if (!canRenderInstances()) {
+        return false;
+    }
+
+    // Every instance is drawn at the same size, so they all share a level of detail
+    GLState::pushMatrix();
+    GLState::scaled(scale, scale, scale);
+    const std::size_t level = selectLevel();
+    GLState::popMatrix();
+
+    glColor3ub(255, 255, 255);
+    Instancing::begin(instances, static_cast<float>(scale));
+    BufferObjects::bind(BufferObjects::ARRAY_BUFFER, vertexBuffer);
+    BufferObjects::bind(BufferObjects::ELEMENT_ARRAY_BUFFER, indexBuffer);
+    for (std::size_t i = 0; i < mesh.sections.size(); ++i) {
+        const auto &section = mesh.sections[i];
+        if (section.vertexCount == 0) {
+            continue;
         }
+        Instancing::setTextured(applyMaterial(i));
+        const IndexRange &range = indexRanges[i][getSectionLevel(i, level)];
+        glInterleavedArrays(GL_T2F_N3F_V3F, 0,
+                            reinterpret_cast<const void *>(section.firstVertex *
+                                                           sizeof(PackedVertex)));
+        Instancing::drawElements(range.count, range.type, range.offset, count);
     }
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    BufferObjects::bind(BufferObjects::ARRAY_BUFFER, 0);
+    BufferObjects::bind(BufferObjects::ELEMENT_ARRAY_BUFFER, 0);
+    Instancing::end();
+    GLState::disable(GL_TEXTURE_2D);
+    return true;
+}
 
-    glDisable(GL_COLOR_MATERIAL);
-    glDisable(GL_TEXTURE_2D);
+std::size_t Object::getLevelCount() const {
+    std::size_t count = 1;
+    for (const auto &section : mesh.sections) {
+        count = std::max(count, section.levels.size() + 1);
+    }
+    return count;
+}
+
+std::size_t Object::selectLevel() {
+    const std::size_t levelCount = getLevelCount();
+    if (levelCount == 1) {
+        return 0;
+    }
+
+    // Height on screen, in pixels, of the bounding box diagonal under the current transform. The
+    // scene projection is orthographic, so this doesn't depend on the distance to the camera.
+    const auto &modelView = GLState::getModelView();
+    const auto &[projection, viewport] = GLState::getView();
+    const auto &[min, max] = mesh.boundingBox;
+    const double diagonal = std::hypot(max.x - min.x, max.y - min.y, max.z - min.z);
+    const double scale = std::hypot(modelView[0], modelView[1], modelView[2]);
+    const double pixels = diagonal * scale * std::abs(projection[5]) * viewport[3] / 2.0;
+
+    // Only switch once the size is well past a threshold so a model sitting right on it doesn't
+    // flicker between two levels. The level is kept per model, which is enough for the
+    // orthographic camera where every instance of a model is drawn at the same size.
+    std::size_t level = 0;
+    while (level + 1 < levelCount && level < LEVEL_PIXELS.size()) {
+        const double threshold = LEVEL_PIXELS[level] * (level < currentLevel ? 1.0 + HYSTERESIS
+                                                                              : 1.0 - HYSTERESIS);
+        if (pixels >= threshold) {
+            break;
+        }
+        ++level;
+    }
+    currentLevel = level;
+    return level;
 }
 
 BoundingBox Object::getBoundingBox() const {
-    return boundingBox;
+    return mesh.boundingBox;
 }
 
 double Object::calculateScaleFactor(double targetSize) const {
+    const auto &boundingBox = mesh.boundingBox;
     const auto maxDimension =
         std::max({boundingBox.max.x - boundingBox.min.x, boundingBox.max.y - boundingBox.min.y,
                   boundingBox.max.z - boundingBox.min.z});
 
     return targetSize / maxDimension;
 }
+
+void Object::releaseResources() {
+    for (GLuint *buffer : {&vertexBuffer, &indexBuffer}) {
+        if (*buffer != 0) {
+            BufferObjects::destroy(*buffer);
+            *buffer = 0;
+        }
+    }
+    indexRanges.clear();
+    for (const GLuint lists : displayLists) {
+        if (lists != 0) {
+            glDeleteLists(lists, static_cast<GLsizei>(mesh.sections.size()));
+        }
+    }
+    displayLists.clear();
+    for (auto &state : materialStates) {
+        if (state.texture != 0) {
+            TextureCache::getInstance().release(state.texture);
+            state.texture = 0;
+        }
+    }
+    loaded = false;
+}
+
+std::size_t Object::getGeometryBytes() const {
+    std::size_t bytes = mesh.vertices.capacity() * sizeof(CompactVertex) +
+                        decodedVertices.capacity() * sizeof(PackedVertex);
+    for (const auto &section : mesh.sections) {
+        bytes += sizeof(Section) + section.name.capacity() + section.material.capacity() +
+                 section.indices.getBytes();
+        for (const auto &level : section.levels) {
+            bytes += level.getBytes();
+        }
+    }
+    return bytes;
+}
+
+double Object::getWeldRatio() const {
+    if (mesh.vertices.empty()) {
+        return 0.0;
+    }
+    std::size_t corners = 0;
+    for (const auto &section : mesh.sections) {
+        corners += section.indices.size();
+    }
+    return static_cast<double>(corners) / mesh.vertices.size();
+}
+
+std::size_t Object::getTextureBytes() const {
+    std::size_t bytes = 0;
+    for (const auto &state : materialStates) {
+        if (state.texture == 0) {
+            continue;
+        }
+        GLint width = 0, height = 0;
+        GLState::bindTexture(GL_TEXTURE_2D, state.texture);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+        // RGBA8, plus a third for the mip chain
+        bytes += static_cast<std::size_t>(width) * height * 4 * 4 / 3;
+    }
+    GLState::bindTexture(GL_TEXTURE_2D, 0);
+    return bytes;
+}
@@ -1,38 +1,19 @@
 #pragma once
 
 #include "Material.h"
+#include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "RenderQueue.h"
+#include "TextureLoader.h"
 #include "freeglut.h"
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <sstream>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
-struct Vertex {
-    double x, y, z;
-};
-
-struct TextureCoord {
-    double u, v;
-};
-
-struct Normal {
-    double nx, ny, nz;
-};
-
-struct Face {
-    // (vertex_index, texture_index, normal_index)
-    std::vector<std::tuple<int, int, int>> vertex_indices;
-};
-
-struct Group {
-    std::string name;
-    std::string material;
-    std::vector<Face> faces;
-};
-
-struct BoundingBox {
-    Vertex min, max;
-};
-
 struct ScrollingTexture {
     std::pair<double, double> velocity; // Direction and speed of scrolling (X and Y) in seconds
     std::pair<double, double> offset;   // Current offset
@@ -40,34 +21,166 @@ struct ScrollingTexture {
 
 class Object {
   public:
+    // How objects are drawn. With buffer objects, the default, the geometry is uploaded to video
+    // memory once. The legacy path draws from client memory every frame and compiles static
+    // objects into display lists; it is kept for comparison.
+    enum class RenderPath { BufferObjects, Legacy };
+
     // Constructor
     Object() = default;
+    // Models are shared through ModelRegistry instead of being copied
+    Object(const Object &) = delete;
+    Object &operator=(const Object &) = delete;
 
     void loadFromFile(const std::string &filename);
+    // loadFromFile in two steps: prepare reads the mesh and materials and decodes the textures
+    // without touching OpenGL, so it can run on a worker thread. upload then creates the textures
+    // on the GL thread, after which the object can be rendered.
+    void prepare(const std::string &filename);
+    void upload();
+    bool isLoaded() const {
+        return loaded;
+    }
+    // True if prepare found no geometry, e.g. because the OBJ failed to parse
+    bool isEmpty() const {
+        return mesh.vertices.empty();
+    }
+    // The OBJ and MTL files the model was prepared from
+    const std::vector<std::string> &getSourceFiles() const {
+        return sourceFiles;
+    }
+    // Takes over the geometry, materials and GL resources of a freshly loaded replacement, which
+    // gets the old ones in exchange and should release them. Scrolling groups are kept. GL thread
+    // only, between frames.
+    void swapContents(Object &replacement);
     void loadMaterialLibrary(const std::string &mtlPath, const std::string &texturePath);
-    void parseMaterialFile(std::ifstream &inputFile);
+    void parseMaterialFile(std::istream &inputFile);
+    // Returns the ID of the material with the given name, adding it if it is new
+    std::uint16_t internMaterial(const std::string &name);
     Color parseColor(std::istringstream &stream);
     void setGroupWithScrollingTexture(const std::string &groupName, double speedX, double speedY);
     BoundingBox getBoundingBox() const;
     double calculateScaleFactor(double targetSize) const;
+    // Submits a draw per section to the render queue, under the current modelview matrix
     void render();
+    // Whether renderInstances can draw the object, which has to be known before submitting it
+    bool canRenderInstances() const;
+    // Draws count copies at once, each scaled by scale and moved by an x, y, z offset read from
+    // the buffer object instances, right away rather than through the render queue. Returns
+    // false, drawing nothing, if the object isn't loaded or can't be instanced (see Instancing),
+    // in which case each copy has to be rendered by itself.
+    bool renderInstances(GLuint instances, GLsizei count, double scale);
     void update(const double deltaTime);
+    // Frees the buffers, display lists and textures. The object can't be rendered afterwards.
+    void releaseResources();
+
+    // Applies to objects uploaded afterwards, so set it before loading anything
+    static void setRenderPath(RenderPath path) {
+        renderPath = path;
+    }
+    static RenderPath getRenderPath() {
+        return renderPath;
+    }
+
+    // Memory held by the parsed geometry in RAM
+    std::size_t getGeometryBytes() const;
+    // Estimated video memory used by the textures, including mipmaps
+    std::size_t getTextureBytes() const;
+    // Triangle corners of the OBJ per vertex left after welding identical ones, 0 if empty
+    double getWeldRatio() const;
+    // Vertex cache use before and after the triangles were reordered, when they were on this load
+    // rather than read already reordered from the binary cache
+    struct Reordering {
+        MeshOptimizer::CacheStats before;
+        MeshOptimizer::CacheStats after;
+    };
+    const std::optional<Reordering> &getReordering() const {
+        return reordering;
+    }
 
   private:
-    std::vector<Vertex> vertices;
-    std::vector<TextureCoord> textureCoords;
-    std::vector<Normal> normals;
-    std::unordered_map<std::string, Group> groups;
-    BoundingBox boundingBox{};
+    IndexedMesh mesh;
+    // mesh.vertices expanded to floats for the legacy path, only kept while its display lists are
+    // being compiled
+    std::vector<PackedVertex> decodedVertices;
+
+    static constexpr std::uint16_t NO_MATERIAL{0xFFFF};
+
+    // Materials of all the loaded libraries, indexed by material ID
+    std::vector<Material> materials;
+    std::unordered_map<std::string, std::uint16_t> materialIds; // Only used while loading
 
-    std::vector<std::string> materialLibraries; // The material library files
-    std::unordered_map<std::string, Material> materials;
-    std::unordered_map<std::string, GLuint> textures;
+    // A material's GL state, in the form the render queue sorts and sets it in
+    struct MaterialState : RenderQueue::Material {
+        GLuint texture{0}; // 0 if the material isn't textured
+    };
+    std::vector<MaterialState> materialStates; // Indexed by material ID
+
+    // What render needs for each of mesh.sections, resolved once so drawing doesn't look anything
+    // up by name
+    struct SectionState {
+        std::uint16_t material{NO_MATERIAL};
+        ScrollingTexture *scrolling{nullptr}; // Points into scrollingTextures
+    };
+    std::vector<SectionState> sectionStates;
+
+    struct PendingTexture {
+        std::string path;
+        TextureLoader::Image image; // Empty if the texture was already cached
+    };
+    // Textures decoded by prepare, keyed by material ID
+    std::unordered_map<std::uint16_t, PendingTexture> pendingTextures;
+    bool loaded{false};
 
     std::unordered_map<std::string, ScrollingTexture> scrollingTextures;
+    std::vector<std::string> sourceFiles;
+    std::optional<Reordering> reordering;
+
+    static inline RenderPath renderPath{RenderPath::BufferObjects};
+
+    // Geometry in video memory on the buffer object path, 0 on the legacy path
+    GLuint vertexBuffer{0};
+    GLuint indexBuffer{0};
+    // Where one index buffer of a section lives in indexBuffer
+    struct IndexRange {
+        std::size_t offset; // In bytes
+        GLsizei count;
+        GLenum type;
+    };
+    // Per section, the full detail indices followed by those of section.levels
+    std::vector<std::vector<IndexRange>> indexRanges;
+
+    // First of the display lists of each level of detail, one per section, compiled the first time
+    // the level is drawn. Only used on the legacy path. The lists hold geometry only: materials
+    // are set by the render queue and animated state such as scrolling texture offsets around
+    // each list, so every object can keep its geometry cached.
+    std::vector<GLuint> displayLists;
 
-    GLuint displayListID = 0;
+    // Height on screen, in pixels, below which each level of detail gives way to the next one
+    static constexpr std::array<double, 3> LEVEL_PIXELS{80.0, 40.0, 20.0};
+    // How far past a threshold the size has to go before the level changes
+    static constexpr double HYSTERESIS{0.15};
+    std::size_t currentLevel{0};
 
-     // An object is static none of it's properties change (textures, geometry...)
-    bool isStatic() const;
+    // Full detail plus the most simplified levels any section has
+    std::size_t getLevelCount() const;
+    // Picks the level of detail from the size the model will have on screen
+    std::size_t selectLevel();
+    // Fills materialStates and sectionStates once the mesh and its materials are loaded
+    void resolveMaterials();
+    // Points the sections of every scrolling group at their entry in scrollingTextures
+    void linkScrollingTextures();
+    // Uploads the vertices and every index buffer of the mesh into vertexBuffer and indexBuffer
+    void createBuffers();
+    // Compiles the display lists of a level of detail on the legacy path
+    void compileLevel(std::size_t level);
+    // Draws section i at a level of detail from the render queue, which has already set its
+    // material and buffers, with its animated state around it
+    void drawSection(std::size_t i, std::size_t level) const;
+    // Draws the triangles of section i, without any material or animated state
+    void drawGeometry(std::size_t i, std::size_t level) const;
+    // Sets the material of section i for the instanced draws. Returns whether it is textured.
+    bool applyMaterial(std::size_t i);
+    // Index into section i's index buffers (full detail, then its levels) for a level of detail
+    std::size_t getSectionLevel(std::size_t i, std::size_t level) const;
 };
@@ -1,7 +1,11 @@
 #include "freeglut.h"
 #include "Player.h"
+#include "GLState.h"
 #include "MapData.h"
+#include "ModelRegistry.h"
+#include "RenderQueue.h"
 #include "WorldScene.h"
+#include "glig.h"
 #include <algorithm>
 #include "BattleScene.h"
 
@@ -11,20 +15,14 @@ Player::Player() {
 }
 
 void Player::setIdleModel(const std::string &filename) {
-    idleModel.loadFromFile(filename);
-    BoundingBox box = idleModel.getBoundingBox();
-    // Scale the model to fit the 1x1 grid
-    scale = 1.0 / std::max(box.max.x - box.min.x, box.max.z - box.min.z);
-
-    currentModel = std::make_shared<Object>(idleModel);
+    idleModel = ModelRegistry::getInstance().loadAsync(filename);
+    currentModel = idleModel;
 }
 
 void Player::setWalkingModel(const std::vector<std::string> &filenames) {
     walkingModels.clear(); // Clear any previous models
     for (const auto &filename : filenames) {
-        Object model;
-        model.loadFromFile(filename);
-        walkingModels.push_back(std::move(model));
+        walkingModels.push_back(ModelRegistry::getInstance().loadAsync(filename));
     }
 }
 
@@ -102,12 +100,12 @@ bool Player::isTileBlocked(int x, int z) const {
 
 void Player::update(double deltaTime) {
     if (!isMoving) {
-        currentModel = std::make_shared<Object>(idleModel);
+        currentModel = idleModel;
         return;
     }
 
     // Update model to use the walking animation
-    currentModel = std::make_shared<Object>(walkingModels[currentWalkingModel]);
+    currentModel = walkingModels[currentWalkingModel];
 
     moveProgress += moveSpeed * deltaTime;
     // Clamp progress to 1.0
@@ -139,9 +137,26 @@ void Player::update(double deltaTime) {
 
 void Player::render() {
     // Translate to the center of the map
-    glTranslated(x, y, z);
-    glRotated(90 * static_cast<int>(orientation), 0, 1, 0);
-    glScaled(scale, scale, scale);
+    GLState::translated(x, y, z);
+    GLState::rotated(90 * static_cast<int>(orientation), 0, 1, 0);
+
+    // The models stream in after the scene starts, the idle one also sets the scale
+    if (!idleModel->isLoaded() || !currentModel->isLoaded()) {
+        GLState::translated(0.0, 0.4, 0.0);
+        RenderQueue::getInstance().submit(RenderQueue::Pass::Opaque, {},
+                                          [](const void *, std::uintptr_t) {
+                                              glColor3ub(160, 160, 160);
+                                              igSolidCube(0.5, 0.8, 0.5);
+                                              glColor3ub(255, 255, 255);
+                                          },
+                                          nullptr);
+        return;
+    }
+    // Scale the model to fit the 1x1 grid. Worked out every frame, as a hot reload can change the
+    // bounding box
+    const BoundingBox box = idleModel->getBoundingBox();
+    const double scale = 1.0 / std::max(box.max.x - box.min.x, box.max.z - box.min.z);
+    GLState::scaled(scale, scale, scale);
     currentModel->render();
 }
 
@@ -28,12 +28,11 @@ class Player {
     void startWildBattle();
 
   private:
-    Object idleModel;                  // The player's idle 3D model
-    std::vector<Object> walkingModels; // The player's walking 3D models
+    std::shared_ptr<Object> idleModel;                  // The player's idle 3D model
+    std::vector<std::shared_ptr<Object>> walkingModels; // The player's walking 3D models
 
     std::shared_ptr<Object> currentModel;       // The player's current 3D model
     int currentWalkingModel{0};                 // The player's current walking model
-    double scale{1.0};                          // The player's model scale to fit the 1x1 grid
     Direction orientation{Direction::DOWN};     // The player's orientation
     bool hasQueuedMovement = false;             // Whether we have a queued movement
     Direction queuedDirection{Direction::DOWN}; // Store next movement
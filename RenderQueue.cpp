@@ -0,0 +1,165 @@
+#include "RenderQueue.h"
+#include "BufferObjects.h"
+#include "GLState.h"
+#include <algorithm>
+#include <bit>
+#include <iostream>
+
+namespace {
+
+// Width of each field of a key, from the most significant bits down
+constexpr int SHADER_BITS{4};
+constexpr int TEXTURE_BITS{16};
+constexpr int MATERIAL_BITS{16};
+constexpr int DEPTH_BITS{24};
+
+std::uint64_t field(std::uint64_t value, int bits) {
+    return value & ((std::uint64_t{1} << bits) - 1);
+}
+
+// Orders floats like their values, negative ones included, and keeps the top bits
+std::uint64_t depthBits(float depth) {
+    const auto bits = std::bit_cast<std::uint32_t>(depth);
+    const std::uint32_t ordered = (bits & 0x80000000u) != 0 ? ~bits : bits | 0x80000000u;
+    return ordered >> (32 - DEPTH_BITS);
+}
+
+} // namespace
+
+void RenderQueue::submit(Pass pass, const State &state, DrawFunction draw, const void *owner,
+                         std::uintptr_t argument) {
+    add(pass, Shader::FixedFunction, state, false, draw, owner, argument);
+}
+
+void RenderQueue::submitCustom(Pass pass, Shader shader, DrawFunction draw, const void *owner,
+                               std::uintptr_t argument) {
+    add(pass, shader, {}, true, draw, owner, argument);
+}
+
+void RenderQueue::add(Pass pass, Shader shader, const State &state, bool custom,
+                      DrawFunction draw, const void *owner, std::uintptr_t argument) {
+    Command &command = commands.emplace_back();
+    command.modelView = GLState::getModelView();
+    command.state = state;
+    command.custom = custom;
+    command.draw = draw;
+    command.owner = owner;
+    command.argument = argument;
+
+    // Materials have no small ID, any bits that tell the ones of a frame apart will do
+    const auto material = reinterpret_cast<std::uintptr_t>(state.material) / sizeof(Material);
+    std::uint64_t key = static_cast<std::uint64_t>(pass);
+    key = key << SHADER_BITS | field(static_cast<std::uint64_t>(shader), SHADER_BITS);
+    key = key << TEXTURE_BITS | field(state.texture, TEXTURE_BITS);
+    key = key << MATERIAL_BITS | field(material, MATERIAL_BITS);
+    // Overlays keep the order they were submitted in, which breaks ties
+    key = key << DEPTH_BITS;
+    if (pass != Pass::Overlay) {
+        // The camera looks down -z
+        key |= depthBits(-command.modelView[14]);
+    }
+    command.key = key;
+}
+
+void RenderQueue::flush() {
+    order.clear();
+    for (std::size_t i = 0; i < commands.size(); ++i) {
+        order.emplace_back(commands[i].key, static_cast<std::uint32_t>(i));
+    }
+    std::sort(order.begin(), order.end());
+
+    stats = {commands.size(), 0, 0, {}};
+    // Anything drawn outside the queue may have changed the state since the last flush
+    stateKnown = false;
+    GLState::matrixMode(GL_MODELVIEW);
+    GLState::pushMatrix();
+    for (const auto &[key, index] : order) {
+        const Command &command = commands[index];
+        GLState::loadMatrixf(command.modelView.data());
+        // Custom draws start from the defaults, and leave the state unknown
+        apply(command.custom ? State{} : command.state);
+        command.draw(command.owner, command.argument);
+        stateKnown = !command.custom;
+    }
+    GLState::popMatrix();
+    reset();
+    commands.clear();
+    // The queue draws last, so this closes the frame for GLState
+    stats.calls = GLState::endFrame();
+}
+
+void RenderQueue::printStats() const {
+    std::cout << "Render queue: " << stats.draws << " draws, " << stats.stateChanges
+              << " state changes, " << stats.stateChangesAvoided << " avoided; GL state calls: "
+              << stats.calls.issued << " issued, " << stats.calls.elided << " elided" << std::endl;
+}
+
+void RenderQueue::apply(const State &state) {
+    const auto count = [this](bool changed) {
+        ++(changed ? stats.stateChanges : stats.stateChangesAvoided);
+    };
+
+    const bool textured = state.texture != 0;
+    const bool textureChanged = !stateKnown || textured != (current.texture != 0);
+    if (textureChanged) {
+        textured ? GLState::enable(GL_TEXTURE_2D) : GLState::disable(GL_TEXTURE_2D);
+    }
+    count(textureChanged);
+    if (textured) {
+        // The binding outlives GL_TEXTURE_2D being turned off
+        const bool bindingChanged = !stateKnown || state.texture != boundTexture;
+        if (bindingChanged) {
+            GLState::bindTexture(GL_TEXTURE_2D, state.texture);
+            boundTexture = state.texture;
+        }
+        count(bindingChanged);
+    }
+
+    const bool hasMaterial = state.material != nullptr;
+    const bool colorMaterialChanged = !stateKnown || hasMaterial != (current.material != nullptr);
+    if (colorMaterialChanged) {
+        if (hasMaterial) {
+            GLState::colorMaterial(GL_FRONT, GL_DIFFUSE);
+            GLState::enable(GL_COLOR_MATERIAL);
+        } else {
+            GLState::disable(GL_COLOR_MATERIAL);
+        }
+    }
+    count(colorMaterialChanged);
+    if (hasMaterial) {
+        const bool materialChanged = !stateKnown || state.material != uploadedMaterial;
+        if (materialChanged) {
+            GLState::materialfv(GL_FRONT, GL_AMBIENT, state.material->ambient.data());
+            GLState::materialfv(GL_FRONT, GL_DIFFUSE, state.material->diffuse.data());
+            GLState::materialfv(GL_FRONT, GL_SPECULAR, state.material->specular.data());
+            GLState::materialf(GL_FRONT, GL_SHININESS, state.material->shininess);
+            uploadedMaterial = state.material;
+        }
+        count(materialChanged);
+    }
+
+    // Without buffer objects everything is drawn from memory and there is nothing to bind
+    if (BufferObjects::isAvailable()) {
+        const bool vertexBufferChanged = !stateKnown || state.vertexBuffer != current.vertexBuffer;
+        if (vertexBufferChanged) {
+            BufferObjects::bind(BufferObjects::ARRAY_BUFFER, state.vertexBuffer);
+        }
+        count(vertexBufferChanged);
+        const bool indexBufferChanged = !stateKnown || state.indexBuffer != current.indexBuffer;
+        if (indexBufferChanged) {
+            BufferObjects::bind(BufferObjects::ELEMENT_ARRAY_BUFFER, state.indexBuffer);
+        }
+        count(indexBufferChanged);
+    }
+
+    current = state;
+    stateKnown = true;
+}
+
+void RenderQueue::reset() {
+    apply({});
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "GLState.h"
+#include "freeglut.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Collects the draws of a frame and issues them sorted by a 64-bit key (pass, shader, texture,
+// material, depth), so draws sharing a texture or material run back to back and their state is
+// set once. Scenes submit while walking their objects and flush before swapping buffers.
+class RenderQueue {
+  public:
+    // Draws run pass by pass, in this order
+    enum class Pass : std::uint8_t {
+        Opaque,  // Front to back within the same state
+        Overlay, // 2D menus and text over everything else, in submission order
+    };
+    enum class Shader : std::uint8_t { FixedFunction, Instancing };
+
+    // Fixed function material, laid out so it can be passed to glMaterialfv as is
+    struct Material {
+        std::array<GLfloat, 4> ambient;
+        std::array<GLfloat, 4> diffuse;
+        std::array<GLfloat, 4> specular;
+        GLfloat shininess;
+    };
+
+    // What a draw needs set, which the queue only changes where it differs from the draw before
+    struct State {
+        GLuint texture{0};                 // Bound with GL_TEXTURE_2D on, or GL_TEXTURE_2D off
+        const Material *material{nullptr}; // Uploaded with GL_COLOR_MATERIAL on, or it off
+        GLuint vertexBuffer{0};            // Bound to the array buffers, 0 draws from memory
+        GLuint indexBuffer{0};
+    };
+
+    // Issues a draw, with the modelview matrix and state it was submitted with already in place
+    using DrawFunction = void (*)(const void *owner, std::uintptr_t argument);
+
+    struct Stats {
+        std::size_t draws;
+        std::size_t stateChanges;        // Made by the queue
+        std::size_t stateChangesAvoided; // Already made for an earlier draw
+        GLState::Stats calls;            // Of the whole frame, queued or not
+    };
+
+    static RenderQueue &getInstance() {
+        static RenderQueue instance;
+        return instance;
+    }
+
+    RenderQueue(const RenderQueue &) = delete;
+    RenderQueue &operator=(const RenderQueue &) = delete;
+
+    // Queues draw(owner, argument) under the current modelview matrix, as set through GLState.
+    // owner has to stay alive until the flush.
+    void submit(Pass pass, const State &state, DrawFunction draw, const void *owner,
+                std::uintptr_t argument = 0);
+    // Queues a draw that sets up its own state through GLState, like a 2D overlay or the
+    // instancing shader. Everything it may have changed is set again for the next draw.
+    void submitCustom(Pass pass, Shader shader, DrawFunction draw, const void *owner,
+                      std::uintptr_t argument = 0);
+    // Sorts and issues everything submitted since the last flush, then leaves textures, materials
+    // and buffers off. Call once per frame, as it also ends the frame for GLState.
+    void flush();
+    // Of the last flush
+    const Stats &getStats() const {
+        return stats;
+    }
+    // Prints the stats of the last flush, on demand as they change from frame to frame
+    void printStats() const;
+
+  private:
+    RenderQueue() = default;
+
+    struct Command {
+        std::uint64_t key;
+        std::array<GLfloat, 16> modelView;
+        State state;
+        bool custom;
+        DrawFunction draw;
+        const void *owner;
+        std::uintptr_t argument;
+    };
+
+    void add(Pass pass, Shader shader, const State &state, bool custom, DrawFunction draw,
+             const void *owner, std::uintptr_t argument);
+    // Makes the GL state match state, counting what it changes and what it can skip
+    void apply(const State &state);
+    void reset();
+
+    std::vector<Command> commands;
+    std::vector<std::pair<std::uint64_t, std::uint32_t>> order; // Key and index of each command
+    // What the GL state is known to be, unless stateKnown is false
+    State current;
+    GLuint boundTexture{0};
+    const Material *uploadedMaterial{nullptr};
+    bool stateKnown{false};
+    Stats stats{};
+};
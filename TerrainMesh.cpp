@@ -0,0 +1,85 @@
+#include "TerrainMesh.h"
+#include "BufferObjects.h"
+#include "Object.h"
+#include "RenderQueue.h"
+#include "Tile.h"
+#include "Trace.h"
+#include <algorithm>
+
+void TerrainMesh::build(const std::vector<std::vector<std::string>> &terrain,
+                        std::size_t firstRow, std::size_t firstColumn, std::size_t size) {
+    TRACE_SCOPE("Bake terrain");
+    release();
+    atlasRevision = Tile::getAtlasRevision();
+    built = true;
+    for (std::size_t i = firstRow; i < std::min(firstRow + size, terrain.size()); ++i) {
+        for (std::size_t j = firstColumn; j < std::min(firstColumn + size, terrain[i].size());
+             ++j) {
+            Tile::bake(std::stoi(terrain[i][j]), static_cast<float>(j), static_cast<float>(i),
+                       *this);
+        }
+    }
+    for (auto *batch : {&textured, &colored}) {
+        batch->vertexCount = static_cast<GLsizei>(batch->vertices.size() / batch->stride);
+    }
+}
+
+void TerrainMesh::release() {
+    for (auto *batch : {&textured, &colored}) {
+        if (batch->buffer != 0) {
+            BufferObjects::destroy(batch->buffer);
+            batch->buffer = 0;
+        }
+        batch->vertices.clear();
+        batch->vertexCount = 0;
+    }
+    built = false;
+}
+
+void TerrainMesh::addTextured(float u, float v, float x, float y, float z) {
+    textured.vertices.insert(textured.vertices.end(), {u, v, x, y, z});
+}
+
+void TerrainMesh::addColored(const std::array<GLubyte, 3> &color, float x, float y, float z) {
+    colored.vertices.insert(colored.vertices.end(),
+                            {color[0] / 255.0f, color[1] / 255.0f, color[2] / 255.0f, x, y, z});
+}
+
+void TerrainMesh::render(GLuint atlas) {
+    auto &queue = RenderQueue::getInstance();
+    if (textured.vertexCount != 0) {
+        prepare(textured);
+        queue.submit(RenderQueue::Pass::Opaque, {atlas, nullptr, textured.buffer}, draw, &textured,
+                     atlas != 0);
+    }
+    if (colored.vertexCount != 0) {
+        prepare(colored);
+        queue.submit(RenderQueue::Pass::Opaque, {0, nullptr, colored.buffer}, draw, &colored);
+    }
+}
+
+void TerrainMesh::prepare(Batch &batch) {
+    if (batch.buffer != 0 || Object::getRenderPath() != Object::RenderPath::BufferObjects) {
+        return;
+    }
+    batch.buffer = BufferObjects::create();
+    BufferObjects::bind(BufferObjects::ARRAY_BUFFER, batch.buffer);
+    BufferObjects::upload(BufferObjects::ARRAY_BUFFER, batch.vertices.size() * sizeof(GLfloat),
+                          batch.vertices.data());
+    BufferObjects::bind(BufferObjects::ARRAY_BUFFER, 0);
+    batch.vertices.clear();
+    batch.vertices.shrink_to_fit();
+}
+
+void TerrainMesh::draw(const void *owner, std::uintptr_t textured) {
+    const auto &batch = *static_cast<const Batch *>(owner);
+    // Colored vertices bring their own color, textured ones are white unless still loading
+    if (textured != 0) {
+        glColor3ub(255, 255, 255);
+    } else {
+        glColor3ub(120, 160, 100);
+    }
+    // With a buffer bound, the pointer is an offset into it
+    glInterleavedArrays(batch.format, 0, batch.buffer != 0 ? nullptr : batch.vertices.data());
+    glDrawArrays(GL_QUADS, 0, batch.vertexCount);
+}
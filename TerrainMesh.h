@@ -0,0 +1,60 @@
+#pragma once
+
+#include "freeglut.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Part of the terrain of a map baked into static vertex arrays by Tile::bake, so drawing it costs
+// a couple of calls whatever the number of tiles. The arrays move to buffer objects the first time
+// they are drawn, unless the legacy render path is in use.
+class TerrainMesh {
+  public:
+    TerrainMesh() = default;
+    TerrainMesh(const TerrainMesh &) = delete;
+    TerrainMesh &operator=(const TerrainMesh &) = delete;
+
+    // Bakes the tiles of a terrain layer in rows [firstRow, firstRow + size) and the same range of
+    // columns from firstColumn, replacing the previous geometry
+    void build(const std::vector<std::vector<std::string>> &terrain, std::size_t firstRow,
+               std::size_t firstColumn, std::size_t size);
+    // Submits the terrain to the render queue, textured with the tileset atlas (see Tile::getAtlas)
+    // or in a flat color while it is 0
+    void render(GLuint atlas);
+    // Frees the vertices and their buffers
+    void release();
+    bool isBuilt() const {
+        return built;
+    }
+    // The atlas the texture coordinates were baked against (see Tile::getAtlasRevision)
+    std::size_t getAtlasRevision() const {
+        return atlasRevision;
+    }
+
+    // Used by Tile::bake. Textured vertices are white and take their color from the atlas.
+    void addTextured(float u, float v, float x, float y, float z);
+    void addColored(const std::array<GLubyte, 3> &color, float x, float y, float z);
+
+  private:
+    // Quads drawn with the same state, from one array
+    struct Batch {
+        GLenum format{0};      // For glInterleavedArrays
+        std::size_t stride{0}; // Floats per vertex
+        std::vector<GLfloat> vertices{};
+        GLsizei vertexCount{0};
+        GLuint buffer{0}; // vertices in video memory, which then aren't kept
+    };
+
+    // Moves the vertices to a buffer object the first time they are drawn, unless the legacy
+    // render path is in use
+    static void prepare(Batch &batch);
+    // Draws a batch from the render queue, which has bound its buffer and the atlas
+    static void draw(const void *batch, std::uintptr_t textured);
+
+    Batch textured{.format = GL_T2F_V3F, .stride = 5};
+    Batch colored{.format = GL_C3F_V3F, .stride = 6};
+    std::size_t atlasRevision{0};
+    bool built{false};
+};
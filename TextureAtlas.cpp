@@ -0,0 +1,94 @@
+#include "TextureAtlas.h"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <numeric>
+
+namespace {
+
+// Position along a Z-order curve to x and y, taken from the even and odd bits
+std::uint32_t compactBits(std::uint64_t bits) {
+    bits &= 0x5555555555555555;
+    bits = (bits | (bits >> 1)) & 0x3333333333333333;
+    bits = (bits | (bits >> 2)) & 0x0F0F0F0F0F0F0F0F;
+    bits = (bits | (bits >> 4)) & 0x00FF00FF00FF00FF;
+    bits = (bits | (bits >> 8)) & 0x0000FFFF0000FFFF;
+    bits = (bits | (bits >> 16)) & 0x00000000FFFFFFFF;
+    return static_cast<std::uint32_t>(bits);
+}
+
+// Offset of a coordinate into an image of the given size, wrapping like GL_REPEAT
+int wrap(int coordinate, int size) {
+    return (coordinate % size + size) % size;
+}
+
+} // namespace
+
+void TextureAtlas::build(const std::vector<TextureLoader::Image> &images,
+                         TextureLoader::Image &atlas, std::vector<Region> &regions) {
+    static const TextureLoader::Image WHITE{1, 1, 4, 0, {255, 255, 255, 255}};
+    const auto source = [&](std::size_t i) -> const TextureLoader::Image & {
+        const auto &image = images[i];
+        const bool usable = !image.pixels.empty() && (image.channels == 3 || image.channels == 4);
+        return usable ? image : WHITE;
+    };
+
+    std::vector<std::uint32_t> cellSizes(images.size());
+    std::uint64_t area = 0;
+    for (std::size_t i = 0; i < images.size(); ++i) {
+        const auto &image = source(i);
+        cellSizes[i] = 2 * std::bit_ceil(static_cast<std::uint32_t>(
+                               std::max(image.width, image.height)));
+        area += static_cast<std::uint64_t>(cellSizes[i]) * cellSizes[i];
+    }
+    std::uint32_t side = 1;
+    while (static_cast<std::uint64_t>(side) * side < area) {
+        side *= 2;
+    }
+
+    atlas.width = static_cast<int>(side);
+    atlas.height = static_cast<int>(side);
+    atlas.channels = 4;
+    atlas.mipLevels = 0;
+    atlas.pixels.assign(static_cast<std::size_t>(side) * side * 4, 0);
+    regions.assign(images.size(), Region{});
+
+    // Largest cells first, laid out along a Z-order curve: every cell then starts at a multiple of
+    // its own area along the curve, which puts it at a position aligned to its size, and the cells
+    // fill the square without gaps
+    std::vector<std::size_t> order(images.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::ranges::stable_sort(order, std::greater{}, [&](std::size_t i) { return cellSizes[i]; });
+
+    std::uint64_t cursor = 0;
+    for (const std::size_t i : order) {
+        const auto &image = source(i);
+        const int cell = static_cast<int>(cellSizes[i]);
+        const int cellX = static_cast<int>(compactBits(cursor));
+        const int cellY = static_cast<int>(compactBits(cursor >> 1));
+        cursor += static_cast<std::uint64_t>(cell) * cell;
+
+        const int offsetX = (cell - image.width) / 2;
+        const int offsetY = (cell - image.height) / 2;
+        for (int y = 0; y < cell; ++y) {
+            const int sourceY = wrap(y - offsetY, image.height);
+            for (int x = 0; x < cell; ++x) {
+                const int sourceX = wrap(x - offsetX, image.width);
+                const unsigned char *from =
+                    &image.pixels[(static_cast<std::size_t>(sourceY) * image.width + sourceX) *
+                                  image.channels];
+                unsigned char *to =
+                    &atlas.pixels[(static_cast<std::size_t>(cellY + y) * side + cellX + x) * 4];
+                to[0] = from[0];
+                to[1] = from[1];
+                to[2] = from[2];
+                to[3] = image.channels == 4 ? from[3] : 255;
+            }
+        }
+
+        regions[i] = {static_cast<float>(cellX + offsetX) / side,
+                      static_cast<float>(cellY + offsetY) / side,
+                      static_cast<float>(image.width) / side,
+                      static_cast<float>(image.height) / side};
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "TextureLoader.h"
+#include <array>
+#include <vector>
+
+// Packs several small images into one texture so everything drawn with them needs a single bind.
+// Every image sits in the middle of a square power-of-two cell twice its size, and the rest of the
+// cell repeats the image the way GL_REPEAT would. Cells are aligned to their own size, so sampling
+// a little past an image's edge gives the texel its own texture would have, and mipmaps never
+// blend two images until a whole cell has shrunk to a single texel.
+namespace TextureAtlas {
+// Where one image ended up, in texture coordinates of the atlas
+struct Region {
+    float left{0.0f};
+    float top{0.0f};
+    float width{1.0f};
+    float height{1.0f};
+
+    // Turns texture coordinates of the original image (0 to 1) into atlas coordinates
+    std::array<float, 2> map(float u, float v) const {
+        return {left + u * width, top + v * height};
+    }
+};
+
+// Packs images into a power-of-two RGBA atlas. regions gets one entry per image, in order. Images
+// that failed to decode are packed as a single white pixel.
+void build(const std::vector<TextureLoader::Image> &images, TextureLoader::Image &atlas,
+           std::vector<Region> &regions);
+}
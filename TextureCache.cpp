@@ -0,0 +1,96 @@
+#include "TextureCache.h"
+#include "AssetStreamer.h"
+#include "GLState.h"
+#include "TextureLoader.h"
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <system_error>
+
+std::string TextureCache::makeKey(const std::string &path, const bool flipVertically) {
+    std::error_code error;
+    auto canonical = std::filesystem::weakly_canonical(path, error);
+    // The same image loaded with a different orientation is a different texture
+    return (error ? path : canonical.generic_string()) + (flipVertically ? "|f" : "|-");
+}
+
+GLuint TextureCache::acquire(const std::string &path, const bool flipVertically,
+                             const TextureLoader::Image *decoded) {
+    std::string key = makeKey(path, flipVertically);
+    {
+        std::lock_guard lock(mutex);
+        if (auto entry = entries.find(key); entry != entries.end()) {
+            ++hits;
+            ++entry->second.references;
+            return entry->second.texture;
+        }
+    }
+
+    // Decoded and uploaded without the lock, so workers calling contains() don't wait on it
+    const GLuint texture = decoded ? TextureLoader::uploadImage(*decoded)
+                                   : TextureLoader::loadTexture(path, flipVertically);
+    const FileWatcher::WatchId watch =
+        FileWatcher::getInstance().watch(path, [key, path, flipVertically] {
+            TextureCache::getInstance().reload(key, path, flipVertically);
+        });
+
+    std::unique_lock lock(mutex);
+    if (auto entry = entries.find(key); entry != entries.end()) {
+        // Added while this one was loading, keep the first
+        ++hits;
+        ++entry->second.references;
+        const GLuint existing = entry->second.texture;
+        lock.unlock();
+        GLState::deleteTextures(1, &texture);
+        FileWatcher::getInstance().unwatch(watch);
+        return existing;
+    }
+    ++misses;
+    keys[texture] = key;
+    entries.emplace(std::move(key), Entry{texture, 1, watch});
+    return texture;
+}
+
+bool TextureCache::contains(const std::string &path, const bool flipVertically) const {
+    const std::string key = makeKey(path, flipVertically);
+    std::lock_guard lock(mutex);
+    return entries.contains(key);
+}
+
+void TextureCache::release(GLuint texture) {
+    std::lock_guard lock(mutex);
+    auto key = keys.find(texture);
+    if (key == keys.end()) {
+        std::cerr << "Released a texture not owned by the cache: " << texture << std::endl;
+        return;
+    }
+
+    auto entry = entries.find(key->second);
+    if (--entry->second.references == 0) {
+        GLState::deleteTextures(1, &texture);
+        FileWatcher::getInstance().unwatch(entry->second.watch);
+        entries.erase(entry);
+        keys.erase(key);
+    }
+}
+
+void TextureCache::reload(const std::string &key, const std::string &path,
+                          const bool flipVertically) {
+    auto image = std::make_shared<TextureLoader::Image>();
+    AssetStreamer::getInstance().enqueue(
+        [image, path, flipVertically] { TextureLoader::loadImage(path, flipVertically, *image); },
+        [this, image, key] {
+            std::lock_guard lock(mutex);
+            auto entry = entries.find(key);
+            // Keep the old image if the texture was released meanwhile or the new one is broken
+            if (entry != entries.end() && !image->pixels.empty()) {
+                TextureLoader::uploadImage(*image, entry->second.texture);
+            }
+        });
+}
+
+void TextureCache::printStats() const {
+    std::lock_guard lock(mutex);
+    std::cout << "Texture cache: " << entries.size() << " textures, " << hits << " hits, " << misses
+              << " misses" << std::endl;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "FileWatcher.h"
+#include "TextureLoader.h"
+#include "freeglut.h"
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Process-wide cache of uploaded textures, so an image used by several materials, models or tiles
+// is decoded and uploaded only once. Handles are reference counted: every acquire must be paired
+// with a release. acquire and release must run on the GL thread, contains is safe anywhere. When
+// FileWatcher is on, a texture whose image changes on disk is reloaded in the background and
+// uploaded into the same texture name, so everything using it sees the new image.
+class TextureCache {
+  public:
+    static TextureCache &getInstance() {
+        static TextureCache instance;
+        return instance;
+    }
+
+    TextureCache(const TextureCache &) = delete;
+    TextureCache &operator=(const TextureCache &) = delete;
+
+    // Returns the texture for path, loading it with TextureLoader on the first request. A decoded
+    // image, if given, is uploaded instead of reading the file again.
+    GLuint acquire(const std::string &path, const bool flipVertically = true,
+                   const TextureLoader::Image *decoded = nullptr);
+    // Whether the texture is already uploaded, so background loads can skip decoding it
+    bool contains(const std::string &path, const bool flipVertically) const;
+    // Drops one reference and deletes the texture when it was the last one
+    void release(GLuint texture);
+
+    std::size_t getHitCount() const {
+        return hits;
+    }
+    std::size_t getMissCount() const {
+        return misses;
+    }
+    void printStats() const;
+
+  private:
+    TextureCache() = default;
+
+    static std::string makeKey(const std::string &path, const bool flipVertically);
+    // Decodes the image again on a worker thread and then replaces the texture under key
+    void reload(const std::string &key, const std::string &path, const bool flipVertically);
+
+    struct Entry {
+        GLuint texture{0};
+        long references{0};
+        FileWatcher::WatchId watch{0};
+    };
+    // Keyed by canonical path plus load flags
+    std::unordered_map<std::string, Entry> entries;
+    std::unordered_map<GLuint, std::string> keys; // Texture -> key in entries
+    std::size_t hits{0};
+    std::size_t misses{0};
+    mutable std::mutex mutex; // Guards entries against contains() from worker threads
+};
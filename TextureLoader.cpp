@@ -1,30 +1,90 @@
 #include "TextureLoader.h"
+#include "GLState.h"
+#include "MipChain.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include "VirtualFileSystem.h"
 #include "stb_image.h"
+#include <algorithm>
 #include <iostream>
 
-GLuint TextureLoader::loadTexture(const std::string &texturePath, const bool flipVertically) {
-    // Load the texture
-    GLuint texture;
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    // Load the image
+bool TextureLoader::decodeImage(const std::string &texturePath, const bool flipVertically,
+                                Image &image) {
+    TRACE_SCOPE("Decode image", texturePath);
+    AssetFile file;
     int width, height, channels;
-    stbi_set_flip_vertically_on_load(flipVertically);
-    unsigned char *data = stbi_load(texturePath.c_str(), &width, &height, &channels, 0);
-    if (data) {
-        // Load the texture into OpenGL
-        // glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
-        // data);
-        if (channels == 3) {
-            gluBuild2DMipmaps(GL_TEXTURE_2D, GL_RGB, width, height, GL_RGB, GL_UNSIGNED_BYTE, data);
-        } else if (channels == 4) {
-            gluBuild2DMipmaps(GL_TEXTURE_2D, GL_RGBA, width, height, GL_RGBA, GL_UNSIGNED_BYTE,
-                              data);
-        }
-    } else {
+    // The thread's own flip flag, so decodes on other threads don't change this one's
+    stbi_set_flip_vertically_on_load_thread(flipVertically);
+    unsigned char *data =
+        VirtualFileSystem::getInstance().open(texturePath, file)
+            ? stbi_load_from_memory(reinterpret_cast<const stbi_uc *>(file.data()),
+                                    static_cast<int>(file.size()), &width, &height, &channels, 0)
+            : nullptr;
+    if (!data) {
         std::cerr << "Failed to load texture: " << texturePath << std::endl;
+        return false;
     }
+
+    image.width = width;
+    image.height = height;
+    image.channels = channels;
+    image.mipLevels = 0;
+    image.pixels.assign(data, data + static_cast<std::size_t>(width) * height * channels);
     stbi_image_free(data);
+    return true;
+}
+
+bool TextureLoader::loadImage(const std::string &texturePath, const bool flipVertically,
+                              Image &image) {
+    return MipChain::load(texturePath, flipVertically, image) ||
+           decodeImage(texturePath, flipVertically, image);
+}
+
+void TextureLoader::decodeImages(const std::vector<std::string> &texturePaths,
+                                 const bool flipVertically, std::vector<Image> &images) {
+    images.assign(texturePaths.size(), Image{});
+    ThreadPool::getInstance().parallelFor(texturePaths.size(), [&](std::size_t i) {
+        decodeImage(texturePaths[i], flipVertically, images[i]);
+    });
+}
+
+void TextureLoader::loadImages(const std::vector<std::string> &texturePaths,
+                               const bool flipVertically, std::vector<Image> &images) {
+    images.assign(texturePaths.size(), Image{});
+    ThreadPool::getInstance().parallelFor(texturePaths.size(), [&](std::size_t i) {
+        loadImage(texturePaths[i], flipVertically, images[i]);
+    });
+}
+
+GLuint TextureLoader::uploadImage(const Image &image, GLuint texture) {
+    TRACE_SCOPE("Upload texture");
+    if (texture == 0) {
+        glGenTextures(1, &texture);
+    }
+    GLState::bindTexture(GL_TEXTURE_2D, texture);
+    // Rows are tightly packed, which matters for RGB images and the small mip levels
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    // Load the texture into OpenGL
+    const GLenum format = image.channels == 4 ? GL_RGBA : GL_RGB;
+    if (image.mipLevels > 0) {
+        // Baked chain: upload every level as is
+        int width = image.width;
+        int height = image.height;
+        const unsigned char *level = image.pixels.data();
+        for (int i = 0; i < image.mipLevels; ++i) {
+            glTexImage2D(GL_TEXTURE_2D, i, format, width, height, 0, format, GL_UNSIGNED_BYTE,
+                         level);
+            level += static_cast<std::size_t>(width) * height * image.channels;
+            width = std::max(1, width / 2);
+            height = std::max(1, height / 2);
+        }
+    } else if (image.channels == 3) {
+        gluBuild2DMipmaps(GL_TEXTURE_2D, GL_RGB, image.width, image.height, GL_RGB,
+                          GL_UNSIGNED_BYTE, image.pixels.data());
+    } else if (image.channels == 4) {
+        gluBuild2DMipmaps(GL_TEXTURE_2D, GL_RGBA, image.width, image.height, GL_RGBA,
+                          GL_UNSIGNED_BYTE, image.pixels.data());
+    }
     // Set texture parameters
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -33,3 +93,10 @@ GLuint TextureLoader::loadTexture(const std::string &texturePath, const bool fli
 
     return texture;
 }
+
+GLuint TextureLoader::loadTexture(const std::string &texturePath, const bool flipVertically) {
+    // A texture is created even if decoding fails, as before, so callers always get a valid name
+    Image image;
+    loadImage(texturePath, flipVertically, image);
+    return uploadImage(image);
+}
@@ -2,7 +2,32 @@
 
 #include "freeglut.h"
 #include <string>
+#include <vector>
 
 namespace TextureLoader {
+// Decoded pixels waiting to be uploaded
+struct Image {
+    int width{0};
+    int height{0};
+    int channels{0};
+    // Number of pre-built mip levels stored one after the other in pixels, or 0 if pixels only
+    // holds the image and the mipmaps still have to be generated
+    int mipLevels{0};
+    std::vector<unsigned char> pixels;
+};
+
+// Decodes the image file without touching OpenGL. Safe to call from several threads at once.
+bool decodeImage(const std::string &texturePath, const bool flipVertically, Image &image);
+// Like decodeImage, but prefers the baked mip chain of the image if there is a fresh one
+bool loadImage(const std::string &texturePath, const bool flipVertically, Image &image);
+// decodeImage and loadImage for a batch of images, spread over the thread pool. images gets one
+// entry per path, without pixels where loading failed. Safe to call from a pool task.
+void decodeImages(const std::vector<std::string> &texturePaths, const bool flipVertically,
+                  std::vector<Image> &images);
+void loadImages(const std::vector<std::string> &texturePaths, const bool flipVertically,
+                std::vector<Image> &images);
+// Creates a mipmapped texture from a decoded image, or replaces the contents of texture if one is
+// given. Must run on the GL thread.
+GLuint uploadImage(const Image &image, GLuint texture = 0);
 GLuint loadTexture(const std::string &texturePath, const bool flipVertically = true);
 };
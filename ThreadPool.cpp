@@ -0,0 +1,91 @@
+#include "ThreadPool.h"
+#include "Trace.h"
+#include <algorithm>
+#include <atomic>
+#include <string>
+
+ThreadPool::ThreadPool() {
+    const unsigned threadCount = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < threadCount; ++i) {
+        workers.emplace_back([this, i] {
+            Trace::getInstance().setThreadName("Worker " + std::to_string(i));
+            workerLoop();
+        });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::enqueue(std::function<void()> task) {
+    {
+        std::lock_guard lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    condition.notify_one();
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(mutex);
+            condition.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void ThreadPool::parallelFor(std::size_t count, const std::function<void(std::size_t)> &body) {
+    if (count == 0) {
+        return;
+    }
+
+    // Shared with the helper tasks, which may only start after this call has returned
+    struct State {
+        std::atomic<std::size_t> next{0};
+        std::size_t finished{0};
+        std::size_t count{0};
+        const std::function<void(std::size_t)> *body{nullptr};
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+    auto state = std::make_shared<State>();
+    state->count = count;
+    state->body = &body;
+
+    // Claims indices until none are left. body is only used for claimed indices, all of which
+    // finish before parallelFor returns.
+    auto work = [](State &state) {
+        std::size_t index;
+        while ((index = state.next.fetch_add(1)) < state.count) {
+            (*state.body)(index);
+            std::lock_guard lock(state.mutex);
+            if (++state.finished == state.count) {
+                state.done.notify_all();
+            }
+        }
+    };
+
+    const std::size_t helpers = std::min(count - 1, workers.size());
+    for (std::size_t i = 0; i < helpers; ++i) {
+        enqueue([state, work] { work(*state); });
+    }
+    work(*state);
+
+    std::unique_lock lock(state->mutex);
+    state->done.wait(lock, [&] { return state->finished == state->count; });
+}
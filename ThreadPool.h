@@ -0,0 +1,56 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Process-wide pool of worker threads for loading work that doesn't touch OpenGL
+class ThreadPool {
+  public:
+    static ThreadPool &getInstance() {
+        static ThreadPool instance;
+        return instance;
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Runs function on a worker thread
+    template <typename Function>
+    std::future<std::invoke_result_t<Function>> submit(Function &&function) {
+        using Result = std::invoke_result_t<Function>;
+        auto task =
+            std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function));
+        std::future<Result> result = task->get_future();
+        enqueue([task] { (*task)(); });
+        return result;
+    }
+
+    // Calls body(i) for every i in [0, count) and returns once all of them have finished. The
+    // calling thread takes part in the work, so this is safe to use from inside a pool task.
+    void parallelFor(std::size_t count, const std::function<void(std::size_t)> &body);
+
+    std::size_t getThreadCount() const {
+        return workers.size();
+    }
+
+  private:
+    ThreadPool();
+    ~ThreadPool();
+
+    void enqueue(std::function<void()> task);
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping{false};
+};
@@ -1,5 +1,8 @@
 #include "Tile.h"
-#include "TextureLoader.h"
+#include "AssetStreamer.h"
+#include "FileWatcher.h"
+#include <algorithm>
+#include <memory>
 
 std::unordered_map<Tile::TileType, Tile::TileProperties> Tile::tilePropertiesMap = {
     {TileType::Grass, {"./assets/art/tileset/ngrass.png", true}},
@@ -13,21 +16,74 @@ std::unordered_map<Tile::TileType, Tile::TileProperties> Tile::tilePropertiesMap
     {TileType::SeaSide, {"./assets/art/tileset/seaside3.png", false}},
 };
 
-GLuint Tile::getOrLoadTexture(TileType tileType) {
-    if (!tilePropertiesMap.contains(tileType)) {
-        glColor3ub(255, 0, 0); // Set error color.
-        return 0;
+GLuint Tile::atlasTexture{0};
+bool Tile::atlasRequested{false};
+std::size_t Tile::atlasRevision{0};
+
+GLuint Tile::getAtlas() {
+    if (!atlasRequested) {
+        atlasRequested = true;
+        loadAtlas();
+        for (const auto &[tileType, properties] : tilePropertiesMap) {
+            FileWatcher::getInstance().watch(properties.texturePath, loadAtlas);
+        }
     }
+    return atlasTexture;
+}
 
-    auto &properties = tilePropertiesMap.at(tileType);
-    if (properties.textureID == 0) {
-        properties.textureID = TextureLoader::loadTexture(properties.texturePath.c_str(), false);
-        if (properties.textureID == 0) {
-            // Texture loading failed.
-            glColor3ub(255, 0, 0); // Set error color.
+void Tile::loadAtlas() {
+    // Several tile types share an image, each one is packed once
+    auto paths = std::make_shared<std::vector<std::string>>();
+    for (const auto &[tileType, properties] : tilePropertiesMap) {
+        if (std::ranges::find(*paths, properties.texturePath) == paths->end()) {
+            paths->push_back(properties.texturePath);
         }
     }
-    return properties.textureID;
+
+    auto atlas = std::make_shared<TextureLoader::Image>();
+    auto regions = std::make_shared<std::vector<TextureAtlas::Region>>();
+    AssetStreamer::getInstance().enqueue(
+        [paths, atlas, regions] {
+            std::vector<TextureLoader::Image> images;
+            TextureLoader::decodeImages(*paths, false, images);
+            TextureAtlas::build(images, *atlas, *regions);
+        },
+        [paths, atlas, regions] {
+            // Reloads replace the contents of the texture the terrain is already drawn with
+            atlasTexture = TextureLoader::uploadImage(*atlas, atlasTexture);
+            for (auto &[tileType, properties] : tilePropertiesMap) {
+                const auto path = std::ranges::find(*paths, properties.texturePath);
+                properties.atlasRegion = (*regions)[path - paths->begin()];
+            }
+            ++atlasRevision;
+        });
+}
+
+std::size_t Tile::getAtlasRevision() {
+    return atlasRevision;
+}
+
+std::array<float, 3> Tile::Placement::apply(float localX, float localY, float localZ) const {
+    // glRotated about the y axis by a multiple of 90 degrees, exactly, then glTranslated
+    constexpr int COSINE[4]{1, 0, -1, 0};
+    constexpr int SINE[4]{0, 1, 0, -1};
+    const int turn = quarterTurns % 4;
+    return {x + localX * COSINE[turn] + localZ * SINE[turn], localY,
+            z - localX * SINE[turn] + localZ * COSINE[turn]};
+}
+
+void Tile::addTextured(TerrainMesh &mesh, const Placement &placement, TileType tileType,
+                       const std::array<float, 2> &texCoord, float x, float y, float z) {
+    const auto [atlasU, atlasV] =
+        tilePropertiesMap.at(tileType).atlasRegion.map(texCoord[0], texCoord[1]);
+    const auto [meshX, meshY, meshZ] = placement.apply(x, y, z);
+    mesh.addTextured(atlasU, atlasV, meshX, meshY, meshZ);
+}
+
+void Tile::addColored(TerrainMesh &mesh, const Placement &placement,
+                      const std::array<GLubyte, 3> &color, float x, float y, float z) {
+    const auto [meshX, meshY, meshZ] = placement.apply(x, y, z);
+    mesh.addColored(color, meshX, meshY, meshZ);
 }
 
 std::array<std::array<float, 2>, 4> Tile::calculateTexCoords(bool coversEntireTile,
@@ -144,74 +200,58 @@ std::array<std::array<float, 2>, 4> Tile::calculateTexCoords(bool coversEntireTi
     }
 }
 
-void Tile::render(int tileCode) {
+void Tile::bake(int tileCode, float x, float z, TerrainMesh &mesh) {
     // TODO: Remove
     if (tileCode == 5)
         tileCode = 10;
 
     TileType tileType{static_cast<TileType>(tileCode / 10)};
     Region region{static_cast<Region>(tileCode % 10)};
-    bool regionChangesGeometry{false};
+    const Placement placement{x, z, 0};
 
-    GLuint textureID{getOrLoadTexture(tileType)};
+    if (!tilePropertiesMap.contains(tileType)) {
+        constexpr std::array<GLubyte, 3> ERROR_COLOR{255, 0, 0};
+        addColored(mesh, placement, ERROR_COLOR, -0.5f, 0.0f, -0.5f);
+        addColored(mesh, placement, ERROR_COLOR, 0.5f, 0.0f, -0.5f);
+        addColored(mesh, placement, ERROR_COLOR, 0.5f, 0.0f, 0.5f);
+        addColored(mesh, placement, ERROR_COLOR, -0.5f, 0.0f, 0.5f);
+        return;
+    }
 
     if (tileType == TileType::LakeWater) {
-        glColor3ub(99, 198, 255);
-        regionChangesGeometry = true;
+        bakeLakeWaterTile(region, x, z, mesh);
+        return;
     }
 
-    if (!regionChangesGeometry) {
-        if (textureID != 0) {
-            glColor3ub(255, 255, 255);
-            glEnable(GL_TEXTURE_2D);
-            glBindTexture(GL_TEXTURE_2D, textureID);
-        }
-
-        auto &properties = tilePropertiesMap[tileType];
-        auto texCoords = calculateTexCoords(properties.coversEntireTile, tileType, region);
-
-        glBegin(GL_QUADS);
-        glTexCoord2f(texCoords[0][0], texCoords[0][1]);
-        glVertex3f(-0.5, 0.0, -0.5);
-        glTexCoord2f(texCoords[1][0], texCoords[1][1]);
-        glVertex3f(0.5, 0.0, -0.5);
-        glTexCoord2f(texCoords[2][0], texCoords[2][1]);
-        glVertex3f(0.5, 0.0, 0.5);
-        glTexCoord2f(texCoords[3][0], texCoords[3][1]);
-        glVertex3f(-0.5, 0.0, 0.5);
-        glEnd();
-
-        if (textureID != 0) {
-            glDisable(GL_TEXTURE_2D);
-        }
-    } else {
-        glPushMatrix();
-        using enum TileType;
-        switch (tileType) {
-        case LakeWater:
-            Tile::renderLakeWaterTile(region);
-            break;
-        }
-        glPopMatrix();
-    }
-    /*glDisable(GL_TEXTURE_2D);*/
+    auto &properties = tilePropertiesMap.at(tileType);
+    auto texCoords = calculateTexCoords(properties.coversEntireTile, tileType, region);
+    addTextured(mesh, placement, tileType, texCoords[0], -0.5f, 0.0f, -0.5f);
+    addTextured(mesh, placement, tileType, texCoords[1], 0.5f, 0.0f, -0.5f);
+    addTextured(mesh, placement, tileType, texCoords[2], 0.5f, 0.0f, 0.5f);
+    addTextured(mesh, placement, tileType, texCoords[3], -0.5f, 0.0f, 0.5f);
 }
 
-void Tile::renderLakeWaterTile(Region region) {
+void Tile::bakeLakeWaterTile(Region region, float x, float z, TerrainMesh &mesh) {
     using enum Region;
+    using enum TileType;
+    // The edges and corners are modelled for one side and turned to face the others
+    Placement placement{x, z, 0};
     switch (region) {
     case CenterLeft:
-        glRotated(90.0, 0.0, 1.0, 0.0);
+        placement.quarterTurns = 1;
         break;
     case BottomCenter:
     case BottomRight:
-        glRotated(180.0, 0.0, 1.0, 0.0);
+        placement.quarterTurns = 2;
         break;
     case CenterRight:
     case TopRight:
-        glRotated(270.0, 0.0, 1.0, 0.0);
+        placement.quarterTurns = 3;
         break;
     }
+    const auto side = [&](float u, float v, float vertexX, float vertexY, float vertexZ) {
+        addTextured(mesh, placement, SeaSide, {u, v}, vertexX, vertexY, vertexZ);
+    };
 
     std::array<std::array<float, 2>, 4> texCoords;
     switch (region) {
@@ -220,64 +260,34 @@ void Tile::renderLakeWaterTile(Region region) {
     case BottomLeft:
     case BottomRight:
         // Default -> TopLeft
-        glColor3ub(255, 255, 255);
-        glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, getOrLoadTexture(TileType::SeaSide));
-
-        glBegin(GL_QUADS);
         // Top
-        glTexCoord2d(1.0, 0.25);
-        glVertex3f(-0.5, 0.0, -0.5);
-        glTexCoord2d(0.0, 0.25);
-        glVertex3f(-0.5, 0.0, 0.5);
-        glTexCoord2d(0.0, 0.5);
-        glVertex3f(-0.375, -0.125, 0.5);
-        glTexCoord2d(0.875, 0.5);
-        glVertex3f(-0.375, -0.125, -0.375);
+        side(1.0f, 0.25f, -0.5f, 0.0f, -0.5f);
+        side(0.0f, 0.25f, -0.5f, 0.0f, 0.5f);
+        side(0.0f, 0.5f, -0.375f, -0.125f, 0.5f);
+        side(0.875f, 0.5f, -0.375f, -0.125f, -0.375f);
 
-        glTexCoord2d(0.0, 0.25);
-        glVertex3f(-0.5, 0.0, -0.5);
-        glTexCoord2d(0.125, 0.5);
-        glVertex3f(-0.375, -0.125, -0.375);
-        glTexCoord2d(1.0, 0.5);
-        glVertex3f(0.5, -0.125, -0.375);
-        glTexCoord2d(1.0, 0.25);
-        glVertex3f(0.5, 0.0, -0.5);
+        side(0.0f, 0.25f, -0.5f, 0.0f, -0.5f);
+        side(0.125f, 0.5f, -0.375f, -0.125f, -0.375f);
+        side(1.0f, 0.5f, 0.5f, -0.125f, -0.375f);
+        side(1.0f, 0.25f, 0.5f, 0.0f, -0.5f);
 
         // Middle
-        glTexCoord2d(1.0, 0.5);
-        glVertex3f(-0.375, -0.125, -0.375);
-        glTexCoord2d(0.0, 0.5);
-        glVertex3f(-0.375, -0.125, 0.5);
-        glTexCoord2d(0.0, 1.0);
-        glVertex3f(-0.25, -0.5625, 0.5);
-        glTexCoord2d(0.875, 1.0);
-        glVertex3f(-0.25, -0.5625, -0.25);
+        side(1.0f, 0.5f, -0.375f, -0.125f, -0.375f);
+        side(0.0f, 0.5f, -0.375f, -0.125f, 0.5f);
+        side(0.0f, 1.0f, -0.25f, -0.5625f, 0.5f);
+        side(0.875f, 1.0f, -0.25f, -0.5625f, -0.25f);
 
-        glTexCoord2d(0.0, 0.5);
-        glVertex3f(-0.375, -0.125, -0.375);
-        glTexCoord2d(0.125, 1.0);
-        glVertex3f(-0.25, -0.5625, -0.25);
-        glTexCoord2d(1.0, 1.0);
-        glVertex3f(0.5, -0.5625, -0.25);
-        glTexCoord2d(1.0, 0.5);
-        glVertex3f(0.5, -0.125, -0.375);
-        glEnd();
+        side(0.0f, 0.5f, -0.375f, -0.125f, -0.375f);
+        side(0.125f, 1.0f, -0.25f, -0.5625f, -0.25f);
+        side(1.0f, 1.0f, 0.5f, -0.5625f, -0.25f);
+        side(1.0f, 0.5f, 0.5f, -0.125f, -0.375f);
 
-        glBindTexture(GL_TEXTURE_2D, getOrLoadTexture(TileType::LakeWater));
         texCoords = calculateTexCoords(false, TileType::LakeWater, TopLeft);
         // Bottom
-        glBegin(GL_QUADS);
-        glTexCoord2f(texCoords[0][0], texCoords[0][1]);
-        glVertex3f(-0.25, -0.5625, -0.25);
-        glTexCoord2f(texCoords[1][0], texCoords[1][1]);
-        glVertex3f(0.5, -0.5625, -0.25);
-        glTexCoord2f(texCoords[2][0], texCoords[2][1]);
-        glVertex3f(0.5, -0.5625, 0.5);
-        glTexCoord2f(texCoords[3][0], texCoords[3][1]);
-        glVertex3f(-0.25, -0.5625, 0.5);
-        glEnd();
-        glDisable(GL_TEXTURE_2D);
+        addTextured(mesh, placement, LakeWater, texCoords[0], -0.25f, -0.5625f, -0.25f);
+        addTextured(mesh, placement, LakeWater, texCoords[1], 0.5f, -0.5625f, -0.25f);
+        addTextured(mesh, placement, LakeWater, texCoords[2], 0.5f, -0.5625f, 0.5f);
+        addTextured(mesh, placement, LakeWater, texCoords[3], -0.25f, -0.5625f, 0.5f);
         break;
 
     case TopCenter:
@@ -285,53 +295,30 @@ void Tile::renderLakeWaterTile(Region region) {
     case CenterLeft:
     case CenterRight:
         // Default -> TopCenter
-        glColor3ub(255, 255, 255);
-        glEnable(GL_TEXTURE_2D);
-        glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, getOrLoadTexture(TileType::SeaSide));
+        side(0.0f, 0.25f, -0.5f, 0.0f, -0.5f);
+        side(0.0f, 0.5f, -0.5f, -0.125f, -0.375f);
+        side(1.0f, 0.5f, 0.5f, -0.125f, -0.375f);
+        side(1.0f, 0.25f, 0.5f, 0.0f, -0.5f);
 
-        glBegin(GL_QUADS);
-        glTexCoord2d(0.0, 0.25);
-        glVertex3f(-0.5, 0.0, -0.5);
-        glTexCoord2d(0.0, 0.5);
-        glVertex3f(-0.5, -0.125, -0.375);
-        glTexCoord2d(1.0, 0.5);
-        glVertex3f(0.5, -0.125, -0.375);
-        glTexCoord2d(1.0, 0.25);
-        glVertex3f(0.5, 0.0, -0.5);
+        side(0.0f, 0.5f, -0.5f, -0.125f, -0.375f);
+        side(0.0f, 1.0f, -0.5f, -0.5625f, -0.25f);
+        side(1.0f, 1.0f, 0.5f, -0.5625f, -0.25f);
+        side(1.0f, 0.5f, 0.5f, -0.125f, -0.375f);
 
-        glTexCoord2d(0.0, 0.5);
-        glVertex3f(-0.5, -0.125, -0.375);
-        glTexCoord2d(0.0, 1.0);
-        glVertex3f(-0.5, -0.5625, -0.25);
-        glTexCoord2d(1.0, 1.0);
-        glVertex3f(0.5, -0.5625, -0.25);
-        glTexCoord2d(1.0, 0.5);
-        glVertex3f(0.5, -0.125, -0.375);
-        glEnd();
-
-        glBindTexture(GL_TEXTURE_2D, getOrLoadTexture(TileType::LakeWater));
         texCoords = calculateTexCoords(false, TileType::LakeWater, TopCenter);
-        glBegin(GL_QUADS);
-        glTexCoord2f(texCoords[0][0], texCoords[0][1]);
-        glVertex3f(-0.5, -0.5625, -0.25);
-        glTexCoord2f(texCoords[1][0], texCoords[1][1]);
-        glVertex3f(0.5, -0.5625, -0.25);
-        glTexCoord2f(texCoords[2][0], texCoords[2][1]);
-        glVertex3f(0.5, -0.5625, 0.5);
-        glTexCoord2f(texCoords[3][0], texCoords[3][1]);
-        glVertex3f(-0.5, -0.5625, 0.5);
-        glEnd();
-        glDisable(GL_TEXTURE_2D);
+        addTextured(mesh, placement, LakeWater, texCoords[0], -0.5f, -0.5625f, -0.25f);
+        addTextured(mesh, placement, LakeWater, texCoords[1], 0.5f, -0.5625f, -0.25f);
+        addTextured(mesh, placement, LakeWater, texCoords[2], 0.5f, -0.5625f, 0.5f);
+        addTextured(mesh, placement, LakeWater, texCoords[3], -0.5f, -0.5625f, 0.5f);
         break;
 
-    case Center:
-        glBegin(GL_QUADS);
-        glVertex3f(-0.5, -0.5625, -0.5);
-        glVertex3f(-0.5, -0.5625, 0.5);
-        glVertex3f(0.5, -0.5625, 0.5);
-        glVertex3f(0.5, -0.5625, -0.5);
-        glEnd();
+    case Center: {
+        constexpr std::array<GLubyte, 3> WATER_COLOR{99, 198, 255};
+        addColored(mesh, placement, WATER_COLOR, -0.5f, -0.5625f, -0.5f);
+        addColored(mesh, placement, WATER_COLOR, -0.5f, -0.5625f, 0.5f);
+        addColored(mesh, placement, WATER_COLOR, 0.5f, -0.5625f, 0.5f);
+        addColored(mesh, placement, WATER_COLOR, 0.5f, -0.5625f, -0.5f);
         break;
     }
-}
\ No newline at end of file
+    }
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "TerrainMesh.h"
+#include "TextureAtlas.h"
 #include "freeglut.h"
 #include <array>
 #include <string>
@@ -40,16 +42,40 @@ class Tile {
     struct TileProperties {
         std::string texturePath;
         bool coversEntireTile;
-        GLuint textureID{0};
+        TextureAtlas::Region atlasRegion{}; // Where the texture is in the tileset atlas
     };
 
-    static void render(int tileNumber);
+    // The atlas holding every tile texture, which the baked terrain is drawn with. Starts loading
+    // it the first time and is 0 until it has streamed in.
+    static GLuint getAtlas();
+    // Goes up whenever the atlas is (re)built. Terrain baked against an older one has to be baked
+    // again, as the tile textures may have moved.
+    static std::size_t getAtlasRevision();
+    // Adds the quads of a tile centered on (x, 0, z) to mesh
+    static void bake(int tileNumber, float x, float z, TerrainMesh &mesh);
 
   private:
-    static void renderLakeWaterTile(Region region);
+    // Where the vertices of a tile end up: turned about the y axis, then moved to the tile
+    struct Placement {
+        float x, z;
+        int quarterTurns; // Counterclockwise, seen from above
+        std::array<float, 3> apply(float localX, float localY, float localZ) const;
+    };
+
+    static void bakeLakeWaterTile(Region region, float x, float z, TerrainMesh &mesh);
+    // A vertex textured with a point of the tile type's texture
+    static void addTextured(TerrainMesh &mesh, const Placement &placement, TileType tileType,
+                            const std::array<float, 2> &texCoord, float x, float y, float z);
+    static void addColored(TerrainMesh &mesh, const Placement &placement,
+                           const std::array<GLubyte, 3> &color, float x, float y, float z);
 
-    static GLuint getOrLoadTexture(TileType tileType);
+    // Decodes the tile textures and packs them into the atlas in the background. Also called
+    // again when one of them changes on disk.
+    static void loadAtlas();
     static std::array<std::array<float, 2>, 4> calculateTexCoords(bool coversEntireTile,
                                                                   TileType tileType, Region region);
     static std::unordered_map<TileType, TileProperties> tilePropertiesMap;
+    static GLuint atlasTexture;  // 0 until the atlas has streamed in
+    static bool atlasRequested;
+    static std::size_t atlasRevision;
 };
@@ -0,0 +1,111 @@
+#include "Trace.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+// Chrome wants a process ID, any constant will do
+constexpr int PROCESS_ID{1};
+
+void writeString(std::ofstream &file, std::string_view text) {
+    file << '"';
+    for (const char c : text) {
+        switch (c) {
+        case '"':
+            file << "\\\"";
+            break;
+        case '\\':
+            file << "\\\\";
+            break;
+        case '\n':
+            file << "\\n";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[7];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                file << escaped;
+            } else {
+                file << c;
+            }
+        }
+    }
+    file << '"';
+}
+
+} // namespace
+
+Trace::~Trace() {
+    save();
+}
+
+void Trace::enable(const std::string &path) {
+    std::lock_guard lock(mutex);
+    outputPath = path;
+    threadNames[threadNumber()] = "Main thread";
+    enabled = true;
+}
+
+void Trace::setThreadName(const std::string &name) {
+    std::lock_guard lock(mutex);
+    threadNames[threadNumber()] = name;
+}
+
+std::uint32_t Trace::threadNumber() {
+    auto [thread, inserted] = threads.try_emplace(std::this_thread::get_id(),
+                                                  static_cast<std::uint32_t>(threads.size()));
+    if (inserted) {
+        threadNames.push_back("Thread " + std::to_string(thread->second));
+    }
+    return thread->second;
+}
+
+std::int64_t Trace::microseconds(Clock::time_point time) const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(time - origin).count();
+}
+
+void Trace::record(const char *name, std::string detail, Clock::time_point start,
+                   Clock::time_point end) {
+    std::lock_guard lock(mutex);
+    events.push_back({name, std::move(detail), microseconds(start),
+                      microseconds(end) - microseconds(start), threadNumber()});
+}
+
+bool Trace::save() {
+    if (!isEnabled()) {
+        return false;
+    }
+    std::lock_guard lock(mutex);
+    std::ofstream file(outputPath, std::ios::trunc);
+    if (!file) {
+        std::cerr << "Failed to write trace: " << outputPath << std::endl;
+        return false;
+    }
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    for (std::size_t thread = 0; thread < threadNames.size(); ++thread) {
+        file << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << PROCESS_ID
+             << ",\"tid\":" << thread << ",\"args\":{\"name\":";
+        writeString(file, threadNames[thread]);
+        file << "}},\n";
+    }
+    for (const auto &event : events) {
+        file << "{\"name\":";
+        writeString(file, event.name);
+        file << ",\"ph\":\"X\",\"ts\":" << event.start << ",\"dur\":" << event.duration
+             << ",\"pid\":" << PROCESS_ID << ",\"tid\":" << event.thread;
+        if (!event.detail.empty()) {
+            file << ",\"args\":{\"detail\":";
+            writeString(file, event.detail);
+            file << '}';
+        }
+        file << "},\n";
+    }
+    // Closing metadata event, so every real event can end with a comma
+    file << "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":" << PROCESS_ID
+         << ",\"args\":{\"name\":\"SGI Project\"}}\n]}\n";
+
+    std::cout << "Wrote " << events.size() << " trace events to " << outputPath << std::endl;
+    return static_cast<bool>(file);
+}
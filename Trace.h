@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Records timed spans of the loading work and writes them in the Chrome trace event format, to be
+// opened in chrome://tracing or Perfetto. Off unless enabled, in which case the trace is written
+// on exit and whenever save is called.
+class Trace {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    static Trace &getInstance() {
+        static Trace instance;
+        return instance;
+    }
+
+    Trace(const Trace &) = delete;
+    Trace &operator=(const Trace &) = delete;
+
+    void enable(const std::string &path);
+    bool isEnabled() const {
+        return enabled.load(std::memory_order_relaxed);
+    }
+    // Name the calling thread is shown with
+    void setThreadName(const std::string &name);
+
+    // Adds a finished span, usually through TRACE_SCOPE. name must be a string literal.
+    void record(const char *name, std::string detail, Clock::time_point start,
+                Clock::time_point end);
+    // Writes everything recorded so far, if enabled
+    bool save();
+
+  private:
+    Trace() = default;
+    ~Trace();
+
+    struct Event {
+        const char *name;
+        std::string detail;
+        std::int64_t start;    // Microseconds since the trace started
+        std::int64_t duration;
+        std::uint32_t thread;
+    };
+
+    // Small sequential number for the calling thread. Call with mutex held.
+    std::uint32_t threadNumber();
+    std::int64_t microseconds(Clock::time_point time) const;
+
+    std::atomic<bool> enabled{false};
+    const Clock::time_point origin{Clock::now()};
+    std::string outputPath;
+    std::mutex mutex;
+    std::vector<Event> events;
+    std::unordered_map<std::thread::id, std::uint32_t> threads;
+    std::vector<std::string> threadNames; // Indexed by thread number
+};
+
+// Records the time from construction to destruction as a span
+class TraceScope {
+  public:
+    explicit TraceScope(const char *name, std::string_view detail = {}) {
+        if (Trace::getInstance().isEnabled()) {
+            this->name = name;
+            this->detail = detail;
+            start = Trace::Clock::now();
+        }
+    }
+    ~TraceScope() {
+        if (name != nullptr) {
+            Trace::getInstance().record(name, std::move(detail), start, Trace::Clock::now());
+        }
+    }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+  private:
+    const char *name{nullptr}; // Null when tracing is off
+    std::string detail;
+    Trace::Clock::time_point start;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+// Traces the rest of the enclosing block: TRACE_SCOPE("Parse OBJ", path)
+#define TRACE_SCOPE(...) TraceScope TRACE_CONCAT(traceScope, __LINE__)(__VA_ARGS__)
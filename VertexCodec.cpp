@@ -0,0 +1,129 @@
+#include "VertexCodec.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+std::uint16_t VertexCodec::floatToHalf(float value) {
+    const std::uint32_t bits = std::bit_cast<std::uint32_t>(value);
+    const std::uint16_t sign = static_cast<std::uint16_t>((bits >> 16) & 0x8000);
+    const std::uint32_t magnitude = bits & 0x7FFFFFFF;
+
+    if (magnitude >= 0x7F800000) {
+        // Infinity stays infinity, NaN stays NaN
+        return sign | 0x7C00 | (magnitude > 0x7F800000 ? 0x200 : 0);
+    }
+    if (magnitude >= 0x477FF000) {
+        // Rounds to a value past the largest half
+        return sign | 0x7C00;
+    }
+    if (magnitude < 0x38800000) {
+        // Subnormal half: shift the mantissa (with its implicit one) into place, rounding to
+        // nearest even
+        const int shift = 126 - static_cast<int>(magnitude >> 23);
+        if (shift > 24) {
+            return sign;
+        }
+        const std::uint32_t mantissa = (magnitude & 0x7FFFFF) | 0x800000;
+        const std::uint32_t half = mantissa >> shift;
+        const std::uint32_t rest = mantissa & ((1u << shift) - 1);
+        const std::uint32_t halfway = 1u << (shift - 1);
+        return sign | static_cast<std::uint16_t>(
+                          half + (rest > halfway || (rest == halfway && (half & 1))));
+    }
+
+    // Normal half: rebias the exponent and round the mantissa to nearest even
+    const std::uint32_t rebased = magnitude - 0x38000000;
+    const std::uint32_t rounded = rebased + 0xFFF + ((rebased >> 13) & 1);
+    return sign | static_cast<std::uint16_t>(rounded >> 13);
+}
+
+float VertexCodec::halfToFloat(std::uint16_t half) {
+    const std::uint32_t sign = static_cast<std::uint32_t>(half & 0x8000) << 16;
+    const std::uint32_t exponent = (half >> 10) & 0x1F;
+    const std::uint32_t mantissa = half & 0x3FF;
+
+    if (exponent == 0) {
+        // Zero or subnormal
+        const float value = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign ? -value : value;
+    }
+    if (exponent == 0x1F) {
+        return std::bit_cast<float>(sign | 0x7F800000 | (mantissa << 13));
+    }
+    return std::bit_cast<float>(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
+namespace {
+
+std::int16_t toSnorm16(float value) {
+    return static_cast<std::int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+float fromSnorm16(std::int16_t value) {
+    return std::max(value / 32767.0f, -1.0f);
+}
+
+float signNotZero(float value) {
+    return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+} // namespace
+
+CompactVertex VertexCodec::encode(const PackedVertex &vertex) {
+    CompactVertex compact{};
+    compact.x = vertex.x;
+    compact.y = vertex.y;
+    compact.z = vertex.z;
+
+    // Project the normal onto the octahedron |x| + |y| + |z| = 1 and fold the lower half over
+    // the upper one
+    const float length = std::abs(vertex.nx) + std::abs(vertex.ny) + std::abs(vertex.nz);
+    if (length > 0.0f) {
+        float x = vertex.nx / length;
+        float y = vertex.ny / length;
+        if (vertex.nz < 0.0f) {
+            const float foldedX = (1.0f - std::abs(y)) * signNotZero(x);
+            const float foldedY = (1.0f - std::abs(x)) * signNotZero(y);
+            x = foldedX;
+            y = foldedY;
+        }
+        compact.normal[0] = toSnorm16(x);
+        compact.normal[1] = toSnorm16(y);
+    }
+
+    compact.texCoord[0] = floatToHalf(vertex.u);
+    compact.texCoord[1] = floatToHalf(vertex.v);
+    return compact;
+}
+
+PackedVertex VertexCodec::decode(const CompactVertex &vertex) {
+    PackedVertex packed{};
+    packed.x = vertex.x;
+    packed.y = vertex.y;
+    packed.z = vertex.z;
+
+    float x = fromSnorm16(vertex.normal[0]);
+    float y = fromSnorm16(vertex.normal[1]);
+    const float z = 1.0f - std::abs(x) - std::abs(y);
+    if (z < 0.0f) {
+        const float unfoldedX = (1.0f - std::abs(y)) * signNotZero(x);
+        const float unfoldedY = (1.0f - std::abs(x)) * signNotZero(y);
+        x = unfoldedX;
+        y = unfoldedY;
+    }
+    const float length = std::sqrt(x * x + y * y + z * z);
+    packed.nx = x / length;
+    packed.ny = y / length;
+    packed.nz = z / length;
+
+    packed.u = halfToFloat(vertex.texCoord[0]);
+    packed.v = halfToFloat(vertex.texCoord[1]);
+    return packed;
+}
+
+void VertexCodec::decode(const std::vector<CompactVertex> &vertices,
+                         std::vector<PackedVertex> &decoded) {
+    decoded.resize(vertices.size());
+    std::transform(vertices.begin(), vertices.end(), decoded.begin(),
+                   [](const CompactVertex &vertex) { return decode(vertex); });
+}
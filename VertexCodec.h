@@ -0,0 +1,16 @@
+#pragma once
+
+#include "Mesh.h"
+#include <cstdint>
+#include <vector>
+
+// Conversions between the compact vertex format used for storage and the float one OpenGL draws
+namespace VertexCodec {
+std::uint16_t floatToHalf(float value);
+float halfToFloat(std::uint16_t half);
+
+CompactVertex encode(const PackedVertex &vertex);
+PackedVertex decode(const CompactVertex &vertex);
+// Expands a whole vertex array, reusing the storage of decoded
+void decode(const std::vector<CompactVertex> &vertices, std::vector<PackedVertex> &decoded);
+}
@@ -0,0 +1,85 @@
+#include "VirtualFileSystem.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+bool VirtualFileSystem::mount(const std::string &packPath) {
+    TRACE_SCOPE("Mount asset pack", packPath);
+    unmount();
+    if (!pack.open(packPath)) {
+        return false;
+    }
+    if (!AssetPack::validate(pack.data(), pack.size())) {
+        std::cerr << "Ignoring invalid asset pack: " << packPath << std::endl;
+        pack.close();
+        return false;
+    }
+
+    AssetPack::Header header;
+    std::memcpy(&header, pack.data(), sizeof(header));
+    entries = reinterpret_cast<const AssetPack::Entry *>(pack.data() + sizeof(header));
+    entryCount = header.entryCount;
+    paths = pack.data() + sizeof(header) + entryCount * sizeof(AssetPack::Entry);
+    std::cout << "Mounted asset pack " << packPath << " (" << entryCount << " files)"
+              << std::endl;
+    return true;
+}
+
+void VirtualFileSystem::unmount() {
+    pack.close();
+    entries = nullptr;
+    entryCount = 0;
+    paths = nullptr;
+}
+
+const AssetPack::Entry *VirtualFileSystem::find(const std::string &path) const {
+    if (entryCount == 0) {
+        return nullptr;
+    }
+    const std::string name = AssetPack::entryName(path);
+    const auto pathOf = [this](const AssetPack::Entry &entry) {
+        return std::string_view(paths + entry.pathOffset, entry.pathLength);
+    };
+    const auto *last = entries + entryCount;
+    const auto *entry =
+        std::lower_bound(entries, last, name, [&](const AssetPack::Entry &entry, const auto &key) {
+            return pathOf(entry) < key;
+        });
+    return entry != last && pathOf(*entry) == name ? entry : nullptr;
+}
+
+bool VirtualFileSystem::open(const std::string &path, AssetFile &file) const {
+    file.mapping.close();
+    file.contents = {};
+    file.open = false;
+
+    if ((looseFiles || !isMounted()) && file.mapping.open(path)) {
+        file.contents = file.mapping.view();
+        file.open = true;
+        return true;
+    }
+    if (const auto *entry = find(path)) {
+        file.contents = std::string_view(pack.data() + entry->offset, entry->size);
+        file.open = true;
+        return true;
+    }
+    return false;
+}
+
+bool VirtualFileSystem::stat(const std::string &path, FileStamp &stamp) const {
+    if ((looseFiles || !isMounted()) && FileStamp::read(path, stamp)) {
+        return true;
+    }
+    if (const auto *entry = find(path)) {
+        stamp.size = entry->size;
+        stamp.modified = entry->modified;
+        return true;
+    }
+    return false;
+}
+
+bool VirtualFileSystem::exists(const std::string &path) const {
+    FileStamp stamp;
+    return stat(path, stamp);
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "AssetPack.h"
+#include "FileStamp.h"
+#include "MappedFile.h"
+#include <string>
+#include <string_view>
+
+// Contents of an asset, either a loose file mapped into memory or a view into the mounted pack.
+// Only valid while the pack stays mounted.
+class AssetFile {
+  public:
+    bool isOpen() const {
+        return open;
+    }
+    const char *data() const {
+        return contents.data();
+    }
+    std::size_t size() const {
+        return contents.size();
+    }
+    std::string_view view() const {
+        return contents;
+    }
+
+  private:
+    friend class VirtualFileSystem;
+
+    MappedFile mapping; // Unused for packed files
+    std::string_view contents;
+    bool open{false};
+};
+
+// Where the game reads its assets from: loose files first, so they can override what is packed,
+// then the mounted asset pack. Mount the pack before any other thread starts reading; after that
+// the file system is only read and can be used from any thread.
+class VirtualFileSystem {
+  public:
+    static VirtualFileSystem &getInstance() {
+        static VirtualFileSystem instance;
+        return instance;
+    }
+
+    // Maps a pack built by AssetPack::build
+    bool mount(const std::string &packPath);
+    void unmount();
+    bool isMounted() const {
+        return pack.isOpen();
+    }
+    // Loose files are on by default. Turning them off reads everything from the pack.
+    void setLooseFiles(bool enabled) {
+        looseFiles = enabled;
+    }
+
+    bool open(const std::string &path, AssetFile &file) const;
+    // Size and modification time of the loose file, or of its source when it was packed
+    bool stat(const std::string &path, FileStamp &stamp) const;
+    bool exists(const std::string &path) const;
+
+  private:
+    VirtualFileSystem() = default;
+
+    const AssetPack::Entry *find(const std::string &path) const;
+
+    MappedFile pack;
+    const AssetPack::Entry *entries{nullptr};
+    std::size_t entryCount{0};
+    const char *paths{nullptr};
+    bool looseFiles{true};
+};
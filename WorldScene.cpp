@@ -1,5 +1,8 @@
 #include "WorldScene.h"
+#include "GLState.h"
 #include "MouseHandler.h"
+#include "RenderQueue.h"
+#include "Trace.h"
 #include "freeglut.h"
 #include "glig.h"
 #include <algorithm>
@@ -10,7 +13,7 @@
 void WorldScene::initialize() {
     auto &mapInfo = MapData::maps.at(currentMapId);
     if (!isInitialized) {
-        map.loadMap(mapInfo.name);
+        loadMap(mapInfo.name);
         player.setIdleModel("./assets/art/models/lucas/lucas.obj");
         player.setWalkingModel({
             "./assets/art/models/lucas-walk/lucas-walk.obj",
@@ -31,12 +34,19 @@ std::string WorldScene::getCurrentMapId() const {
 void WorldScene::changeMap(const std::string &mapId) {
     auto &mapInfo = MapData::maps.at(mapId);
     currentMapId = mapId;
-    map.loadMap(mapInfo.name);
+    loadMap(mapInfo.name);
     player.setCollisionMap(map.getCollisionMap());
     player.setEventsMap(map.getEvents(), mapId);
     audioEngine.playMusic(mapInfo.soundtrack);
 }
 
+void WorldScene::loadMap(const std::string &mapName) {
+    map.loadMap(mapName);
+    if (syntheticMapSize > 0) {
+        map.makeSynthetic(syntheticMapSize);
+    }
+}
+
 void WorldScene::registerInputCallbacks() {
     glutKeyboardFunc([](unsigned char key, int x, int y) {
         WorldScene::getInstance().keyboardCallback(key, x, y);
@@ -53,35 +63,55 @@ void WorldScene::registerInputCallbacks() {
 void WorldScene::render() {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
+    GLState::matrixMode(GL_MODELVIEW);
+    GLState::loadIdentity();
 
-    glRotated(beta, 1.0, 0.0, 0.0);
-    glRotated(-alpha, 0.0, 1.0, 0.0);
-    glScaled(scale, scale, scale);
+    GLState::rotated(beta, 1.0, 0.0, 0.0);
+    GLState::rotated(-alpha, 0.0, 1.0, 0.0);
+    GLState::scaled(scale, scale, scale);
 
-    glTranslated(-player.getX(), -0.5 - player.getY(), -player.getZ());
+    GLState::translated(-player.getX(), -0.5 - player.getY(), -player.getZ());
 
     map.render();
     renderPlayer();
 
     menu.render();
 
+    RenderQueue::getInstance().flush();
     glutSwapBuffers();
 }
 
 void WorldScene::update(double deltaTime) {
+    if (map.getRevision() != mapRevision) {
+        // A layer was reloaded from disk, the player keeps its own copy
+        mapRevision = map.getRevision();
+        player.setCollisionMap(map.getCollisionMap());
+        player.setEventsMap(map.getEvents(), currentMapId);
+    }
     player.update(deltaTime);
 }
 
 void WorldScene::renderPlayer() {
-    glPushMatrix();
+    GLState::pushMatrix();
     player.render();
-    glPopMatrix();
+    GLState::popMatrix();
 }
 
 void WorldScene::keyboardCallback(unsigned char key, int x, int y) {
     switch (key) {
+    case 't':
+    case 'T':
+        Trace::getInstance().save();
+        break;
+    case 's':
+    case 'S': {
+        // Of the last frame, printed on demand as it changes with every step
+        const Map::ChunkStats chunkStats = map.getChunkStats();
+        std::cout << "Chunks drawn: " << chunkStats.drawn << " / " << chunkStats.total
+                  << std::endl;
+        RenderQueue::getInstance().printStats();
+        break;
+    }
     case 'x':
     case 'X':
         if (menu.isVisible()) {
@@ -29,15 +29,23 @@ class WorldScene : public Scene {
 
     std::string getCurrentMapId() const;
     void changeMap(const std::string &mapId);
+    // Stretches every map to size by size tiles by repeating it (see Map::makeSynthetic). 0, the
+    // default, keeps the maps as they are.
+    void setSyntheticMapSize(std::size_t size) {
+        syntheticMapSize = size;
+    }
 
   private:
     WorldScene() = default; // Private constructor for singleton
 
     void renderPlayer();
+    void loadMap(const std::string &mapName);
 
     Player player;
     Map map;
     std::string currentMapId{"tp-twin"};
+    std::size_t mapRevision{0}; // Of the layers last handed to the player
+    std::size_t syntheticMapSize{0};
     Menu menu;
 
     double alpha{0.0};
@@ -1,9 +1,25 @@
 #include "Scene.h"
+#include "AssetPack.h"
+#include "AssetStreamer.h"
+#include "BufferObjects.h"
+#include "FileWatcher.h"
+#include "GLState.h"
+#include "ModelRegistry.h"
+#include "TextureCache.h"
+#include "Trace.h"
+#include "VirtualFileSystem.h"
+#include "Instancing.h"
 #include "IntroScene.h"
 #include "WorldScene.h"
 #include "BattleScene.h"
+#include "Benchmark.h"
+#include "MeshOptimizer.h"
+#include "MipChain.h"
+#include "Object.h"
 #include "freeglut.h"
 #include "glig.h"
+#include <iostream>
+#include <string_view>
 /* Texture loading library */
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -13,8 +29,17 @@
 
 
 constexpr int REFRESH_RATE{144};
+// Time per frame spent uploading streamed assets to the GPU
+constexpr double UPLOAD_BUDGET_MS{2.0};
 double lastFrameTime{0.0}, deltaTime{0.0};
 
+// Bundle of everything under ./assets, built with --pack-assets. Loose files still win over it.
+const char ASSET_PACK[]{"assets.pack"};
+// Written with --trace, on exit or when T is pressed
+const char TRACE_FILE[]{"trace.json"};
+// Tiles along each side of the maps with --synthetic-map
+constexpr std::size_t SYNTHETIC_MAP_SIZE{1024};
+
 constexpr int WINDOW_WIDTH{900};
 constexpr int WINDOW_HEIGHT{900};
 const char WINDOW_TITLE[]{"SGI Project"};
@@ -22,6 +47,14 @@ const char WINDOW_TITLE[]{"SGI Project"};
 Scene *scene{&IntroScene::getInstance()};
 
 void display() {
+    // The first frame of every scene is traced, to see when it became playable
+    static Scene *tracedScene{nullptr};
+    if (scene != tracedScene) {
+        tracedScene = scene;
+        TRACE_SCOPE("First frame");
+        scene->render();
+        return;
+    }
     scene->render();
 }
 
@@ -35,11 +68,11 @@ void reshape(int width, int height) {
     // The projection matrix defines how we project 3D coordinates onto a 2D screen.
     // The projection matrix encodes how much of the scene is captured in a render by defining the
     // extents of the camera's view
-    glMatrixMode(GL_PROJECTION);
+    GLState::matrixMode(GL_PROJECTION);
 
     // Reset the projection matrix to the identity matrix.
     // This clears any previous settings, ensuring a fresh start.
-    glLoadIdentity();
+    GLState::loadIdentity();
 
     // Set up an orthographic projection matrix.
     // This means objects are rendered without perspective distortion.
@@ -59,11 +92,18 @@ void createWindow(int argc, char **argv) {
     // Set window size and create the window
     glutInitWindowSize(WINDOW_WIDTH, WINDOW_HEIGHT);
     glutCreateWindow(WINDOW_TITLE);
+    if (Object::getRenderPath() == Object::RenderPath::BufferObjects && !BufferObjects::load()) {
+        std::cerr << "No buffer object support, using the legacy renderer" << std::endl;
+        Object::setRenderPath(Object::RenderPath::Legacy);
+    }
+    if (Object::getRenderPath() == Object::RenderPath::BufferObjects && !Instancing::load()) {
+        std::cerr << "No instancing support, drawing map props one by one" << std::endl;
+    }
     // Register callback functions for display and reshape
     glutDisplayFunc(display);
     glutReshapeFunc(reshape);
     // Set default display values
-    glEnable(GL_DEPTH_TEST);
+    GLState::enable(GL_DEPTH_TEST);
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glColor3ub(255, 255, 255);
 }
@@ -73,6 +113,13 @@ void timer(int) {
     deltaTime = currentTime - lastFrameTime;
     lastFrameTime = currentTime;
 
+    // Reloads of changed files are streamed in like any other asset
+    FileWatcher::getInstance().poll();
+    if (AssetStreamer::getInstance().pump(UPLOAD_BUDGET_MS)) {
+        // Everything requested so far has arrived
+        ModelRegistry::getInstance().printReport();
+        TextureCache::getInstance().printStats();
+    }
     scene->update(deltaTime);
 
     glutPostRedisplay(); // Request to redraw the window
@@ -81,8 +128,63 @@ void timer(int) {
 
 // argc: argument count, argv: argument vector
 int main(int argc, char **argv) {
-    createWindow(argc, argv);
-    scene->initialize();
+    for (int i = 1; i < argc; ++i) {
+        if (std::string_view(argv[i]) == "--no-mesh-optimization") {
+            // Keep the triangles in file order, to compare against the optimized order
+            MeshOptimizer::setEnabled(false);
+        } else if (std::string_view(argv[i]) == "--trace") {
+            Trace::getInstance().enable(TRACE_FILE);
+        } else if (std::string_view(argv[i]) == "--legacy-renderer") {
+            // Draw models from client memory and display lists, to compare against buffers
+            Object::setRenderPath(Object::RenderPath::Legacy);
+        } else if (std::string_view(argv[i]) == "--hot-reload") {
+            // Reload models, textures and map layers when they are edited in ./assets
+            FileWatcher::getInstance().enable();
+        } else if (std::string_view(argv[i]) == "--synthetic-map") {
+            // Repeat every map to see how rendering holds up on a large one
+            WorldScene::getInstance().setSyntheticMapSize(SYNTHETIC_MAP_SIZE);
+        }
+    }
+
+    if (argc > 1 && std::string_view(argv[1]) == "--benchmark-obj") {
+        Benchmark::runObjLoad("./assets");
+        return 0;
+    }
+    if (argc > 1 && std::string_view(argv[1]) == "--benchmark-memory") {
+        Benchmark::runMeshMemory("./assets");
+        return 0;
+    }
+    if (argc > 1 && std::string_view(argv[1]) == "--benchmark-mesh-order") {
+        Benchmark::runMeshOrder("./assets");
+        return 0;
+    }
+    if (argc > 1 && std::string_view(argv[1]) == "--bake-textures") {
+        MipChain::bakeDirectory("./assets/art");
+        return 0;
+    }
+    if (argc > 1 && std::string_view(argv[1]) == "--pack-assets") {
+        return AssetPack::build("./assets", ASSET_PACK) ? 0 : 1;
+    }
+    if (argc > 1 && std::string_view(argv[1]) == "--benchmark-pack") {
+        Benchmark::runAssetPack("./assets");
+        return 0;
+    }
+    if (argc > 1 && std::string_view(argv[1]) == "--benchmark-decode") {
+        Benchmark::runImageDecode("./assets");
+        return 0;
+    }
+
+    // Before anything starts loading, and before the loading threads exist
+    VirtualFileSystem::getInstance().mount(ASSET_PACK);
+
+    {
+        TRACE_SCOPE("Create window");
+        createWindow(argc, argv);
+    }
+    {
+        TRACE_SCOPE("Initialize scene");
+        scene->initialize();
+    }
     // Request to redraw the window at a fixed rate
     glutTimerFunc(1000 / REFRESH_RATE, timer, 0);
     glutMainLoop();